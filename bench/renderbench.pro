@@ -0,0 +1,15 @@
+TEMPLATE = app
+TARGET = renderbench
+INCLUDEPATH += ../src
+DEPENDSPATH += ../src
+DESTDIR = ../bin
+win32: LIBS += -L../bin
+else: LIBS += -L../lib
+LIBS += -lQmlRenderer
+
+QT = core testlib qml quick
+CONFIG += depend_includepath
+CONFIG -= app_bundle
+DEFINES += BENCH_SCENES_DIR=\\\"$$PWD/scenes\\\" BENCH_REFERENCE_DIR=\\\"$$PWD/../test/reference_output\\\"
+SOURCES += tst_bench.cpp
+HEADERS += tst_bench.h
@@ -0,0 +1,28 @@
+import QtQuick 2.0
+
+// Scaled and faded photos, texture upload and sampling
+Rectangle {
+    color: "black"
+
+    Grid {
+        anchors.fill: parent
+        columns: 8
+
+        Repeater {
+            model: 64
+            Image {
+                width: parent.width / 8
+                height: parent.height / 8
+                source: Qt.resolvedUrl("../../test/reference_output/output_" + (index % 20 + 1) + ".jpg")
+                fillMode: Image.PreserveAspectCrop
+                smooth: true
+
+                SequentialAnimation on opacity {
+                    loops: Animation.Infinite
+                    NumberAnimation { from: 1; to: 0.2; duration: 500 + index * 10 }
+                    NumberAnimation { from: 0.2; to: 1; duration: 500 + index * 10 }
+                }
+            }
+        }
+    }
+}
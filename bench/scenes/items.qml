@@ -0,0 +1,24 @@
+import QtQuick 2.0
+
+// 2000 rectangles moving and rotating, a scene graph with many nodes
+Rectangle {
+    color: "black"
+
+    Repeater {
+        model: 2000
+        Rectangle {
+            width: 24
+            height: 24
+            color: Qt.hsla((index % 360) / 360, 0.8, 0.5, 0.8)
+            x: (index * 37) % (parent.width - width)
+            y: (index * 53) % (parent.height - height)
+
+            NumberAnimation on rotation {
+                from: 0
+                to: 360
+                duration: 1000 + index % 1000
+                loops: Animation.Infinite
+            }
+        }
+    }
+}
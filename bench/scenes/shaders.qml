@@ -0,0 +1,26 @@
+import QtQuick 2.0
+
+// A full frame fragment shader, fill rate bound
+Item {
+    ShaderEffect {
+        anchors.fill: parent
+        property real time: 0
+
+        NumberAnimation on time {
+            from: 0
+            to: 6.2832
+            duration: 2000
+            loops: Animation.Infinite
+        }
+
+        fragmentShader: "
+            varying highp vec2 qt_TexCoord0;
+            uniform lowp float qt_Opacity;
+            uniform highp float time;
+            void main() {
+                highp vec2 p = qt_TexCoord0 * 12.0;
+                highp float v = sin(p.x + time) + sin(p.y * 1.3 + time) + sin((p.x + p.y) * 0.7 + time * 2.0);
+                gl_FragColor = vec4(0.5 + 0.5 * sin(v), 0.5 + 0.5 * sin(v + 2.094), 0.5 + 0.5 * sin(v + 4.188), 1.0) * qt_Opacity;
+            }"
+    }
+}
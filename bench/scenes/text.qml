@@ -0,0 +1,30 @@
+import QtQuick 2.0
+
+// Scrolling lines of text, glyph rendering and layout every frame
+Rectangle {
+    id: root
+    color: "#101018"
+
+    Column {
+        id: lines
+        width: parent.width
+
+        NumberAnimation on y {
+            from: 0
+            to: -root.height
+            duration: 4000
+            loops: Animation.Infinite
+        }
+
+        Repeater {
+            model: 120
+            Text {
+                width: lines.width
+                text: "Line " + index + ": The quick brown fox jumps over the lazy dog 0123456789"
+                color: "white"
+                font.pixelSize: 14 + index % 24
+                wrapMode: Text.WordWrap
+            }
+        }
+    }
+}
@@ -0,0 +1,171 @@
+/*
+Copyright (C) 2019  Akhil K Gangadharan <helloimakhil@gmail.com>
+This file is part of Kdenlive. See www.kdenlive.org.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of
+the License or (at your option) version 3 or any later version
+accepted by the membership of KDE e.V. (or its successor approved
+by the membership of KDE e.V.), which shall act as a proxy
+defined in Section 14 of version 3 of the license.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "tst_bench.h"
+#include <QElapsedTimer>
+#include <QFile>
+
+static const int s_steadyFrames = 50;
+
+static const QList<QPair<QByteArray, QString>> s_scenes = {
+    { "reference", "test.qml" }, { "items", "items.qml" }, { "text", "text.qml" },
+    { "images", "images.qml" }, { "shaders", "shaders.qml" }
+};
+
+static const QList<QPair<QByteArray, QSize>> s_resolutions = {
+    { "720p", QSize(1280, 720) }, { "1080p", QSize(1920, 1080) }, { "4K", QSize(3840, 2160) }
+};
+
+static void addScenes()
+{
+    QTest::addColumn<QString>("scene");
+    for (const auto &scene : s_scenes) {
+        QTest::newRow(scene.first.constData()) << scene.second;
+    }
+}
+
+static void addResolutions(const char *prefix)
+{
+    QTest::addColumn<QSize>("size");
+    for (const auto &size : s_resolutions) {
+        QTest::newRow(QByteArray(prefix).append(size.first).constData()) << size.second;
+    }
+}
+
+QString Bench::sceneUrl(const QString &scene)
+{
+    const QString path = scene == QLatin1String("test.qml") ? QStringLiteral(BENCH_REFERENCE_DIR) : QStringLiteral(BENCH_SCENES_DIR);
+    return QUrl::fromLocalFile(path + QLatin1Char('/') + scene).toString();
+}
+
+void Bench::timeToFirstFrame_data()
+{
+    addScenes();
+}
+
+void Bench::timeToFirstFrame()
+{
+    // Renderer setup, loading the template and the first frame. Only the first
+    // iteration compiles it, the others load it from the QML disk cache
+    QFETCH(QString, scene);
+    QBENCHMARK {
+        QmlRenderer renderer(sceneUrl(scene), 25, 2);
+        renderer.render(1280, 720, QImage::Format_ARGB32_Premultiplied, 0);
+    }
+}
+
+void Bench::steadyState_data()
+{
+    QTest::addColumn<QString>("scene");
+    QTest::addColumn<QSize>("size");
+    for (const auto &scene : s_scenes) {
+        for (const auto &size : s_resolutions) {
+            QTest::newRow((scene.first + ' ' + size.first).constData()) << scene.second << size.second;
+        }
+    }
+}
+
+void Bench::steadyState()
+{
+    // Frames per second of a batch render once the scene is loaded. At 60 fps the
+    // measured frames lie within the one second animation of test.qml, frames
+    // served without rendering would inflate the result
+    QFETCH(QString, scene);
+    QFETCH(QSize, size);
+    QmlRenderer renderer(sceneUrl(scene), 60, 1);
+    renderer.render(size.width(), size.height(), QImage::Format_ARGB32_Premultiplied, 0);
+
+    QElapsedTimer timer;
+    timer.start();
+    const int frames = renderer.renderRange(size.width(), size.height(), QImage::Format_ARGB32_Premultiplied,
+                                            1, s_steadyFrames, [](int, const QImage &) {});
+    QCOMPARE(frames, s_steadyFrames);
+    QCOMPARE(renderer.staticFramesServed(), 0);
+    QTest::setBenchmarkResult(frames * 1e9 / timer.nsecsElapsed(), QTest::FramesPerSecond);
+}
+
+void Bench::readback_data()
+{
+    addResolutions("");
+}
+
+void Bench::readback()
+{
+    // A static scene rendered into a buffer again and again: sync, readback and
+    // conversion with next to no rendering
+    QFETCH(QSize, size);
+    QmlRenderer renderer(sceneUrl("test.qml"), 25, 1);
+    QImage target(size, QImage::Format_ARGB32_Premultiplied);
+    renderer.render(size.width(), size.height(), target.format(), 0, target.bits(), target.bytesPerLine());
+    QBENCHMARK {
+        renderer.render(size.width(), size.height(), target.format(), 0, target.bits(), target.bytesPerLine());
+    }
+}
+
+void Bench::conversion_data()
+{
+    QTest::addColumn<QSize>("size");
+    QTest::addColumn<int>("format");
+    for (const auto &size : s_resolutions) {
+        QTest::newRow((size.first + " BGRA8888").constData()) << size.second << int(QmlPixelConverter::BGRA8888);
+        QTest::newRow((size.first + " YUV420P").constData()) << size.second << int(QmlPixelConverter::YUV420P);
+    }
+}
+
+void Bench::conversion()
+{
+    // CPU side of a readback: flip and convert the GL pixels
+    QFETCH(QSize, size);
+    QFETCH(int, format);
+    const QmlPixelConverter::PixelFormat pixelFormat = QmlPixelConverter::PixelFormat(format);
+    QByteArray pixels(size.width() * size.height() * 4, char(0x80));
+    QVector<QByteArray> planeData;
+    QVector<QmlPixelConverter::Plane> planes;
+    for (int i = 0; i < QmlPixelConverter::planeCount(pixelFormat); ++i) {
+        const QSize planeSize = QmlPixelConverter::planeSize(pixelFormat, i, size);
+        const int bytesPerLine = planeSize.width() * (QmlPixelConverter::planeCount(pixelFormat) == 1 ? 4 : 1);
+        planeData << QByteArray(bytesPerLine * planeSize.height(), 0);
+        planes << QmlPixelConverter::Plane{ reinterpret_cast<uchar *>(planeData.last().data()), bytesPerLine };
+    }
+    QBENCHMARK {
+        QmlPixelConverter::convert(reinterpret_cast<const uchar *>(pixels.constData()), size.width() * 4, size, true,
+                                   pixelFormat, planes.constData());
+    }
+}
+
+void Bench::peakMemory()
+{
+    // Peak resident set size of the whole run, so it has to stay the last slot
+    QFile status(QStringLiteral("/proc/self/status"));
+    if (!status.open(QIODevice::ReadOnly)) {
+        QSKIP("Needs /proc/self/status");
+    }
+    for (const QByteArray &line : status.readAll().split('\n')) {
+        if (line.startsWith("VmHWM:")) {
+            const qint64 kilobytes = line.mid(6).trimmed().split(' ').first().toLongLong();
+            QTest::setBenchmarkResult(kilobytes * 1024, QTest::BytesAllocated);
+            return;
+        }
+    }
+    QSKIP("No VmHWM in /proc/self/status");
+}
+
+QTEST_MAIN(Bench)
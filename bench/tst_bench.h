@@ -0,0 +1,54 @@
+/*
+Copyright (C) 2019  Akhil K Gangadharan <helloimakhil@gmail.com>
+This file is part of Kdenlive. See www.kdenlive.org.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of
+the License or (at your option) version 3 or any later version
+accepted by the membership of KDE e.V. (or its successor approved
+by the membership of KDE e.V.), which shall act as a proxy
+defined in Section 14 of version 3 of the license.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TST_BENCH_H
+#define TST_BENCH_H
+
+#include <QObject>
+#include <QtTest>
+#include "qmlrenderer.h"
+
+/*
+ * Performance numbers to track across releases. Run with a machine readable
+ * logger, e.g. ./renderbench -o bench.xml,xml or -o bench.csv,csv, on software
+ * GL for comparable numbers:
+ *   QT_QPA_PLATFORM=offscreen LIBGL_ALWAYS_SOFTWARE=1 ./renderbench -o -,csv
+*/
+class Bench : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void timeToFirstFrame_data();
+    void timeToFirstFrame();
+    void steadyState_data();
+    void steadyState();
+    void readback_data();
+    void readback();
+    void conversion_data();
+    void conversion();
+    void peakMemory();
+
+private:
+    static QString sceneUrl(const QString &scene);
+};
+
+#endif // TST_BENCH_H
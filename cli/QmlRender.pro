@@ -7,5 +7,5 @@ else: LIBS += -L../lib
 LIBS += -lQmlRenderer
 TARGET = QmlRender
 QT = core qml quick widgets
-SOURCES += main.cpp qmlrender.cpp
-HEADERS += qmlrender.h
+SOURCES += main.cpp qmlrender.cpp rawvideowriter.cpp imagesequenceencoder.cpp
+HEADERS += qmlrender.h rawvideowriter.h imagesequenceencoder.h
@@ -0,0 +1,114 @@
+/*
+Copyright (C) 2019  Akhil K Gangadharan <helloimakhil@gmail.com>
+This file is part of Kdenlive. See www.kdenlive.org.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of
+the License or (at your option) version 3 or any later version
+accepted by the membership of KDE e.V. (or its successor approved
+by the membership of KDE e.V.), which shall act as a proxy
+defined in Section 14 of version 3 of the license.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "imagesequenceencoder.h"
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QImageWriter>
+#include <QRunnable>
+
+class ImageSequenceEncoder::Task : public QRunnable
+{
+public:
+    Task(ImageSequenceEncoder *encoder, int frame, const QImage &image)
+        : m_encoder(encoder)
+        , m_frame(frame)
+        , m_image(image)
+    {
+    }
+
+    void run() override
+    {
+        m_encoder->write(m_frame, m_image);
+    }
+
+private:
+    ImageSequenceEncoder *m_encoder;
+    int m_frame;
+    QImage m_image;
+};
+
+ImageSequenceEncoder::ImageSequenceEncoder(const QString &directory, const QString &baseName, const QByteArray &format,
+                                           int threads, int maxPending)
+    : m_directory(directory)
+    , m_baseName(baseName)
+    , m_format(format)
+    , m_quality(-1)
+    , m_compression(-1)
+    , m_slots(maxPending > 0 ? maxPending : 2 * qMax(1, threads))
+    , m_encodeTime(0)
+    , m_waitTime(0)
+    , m_failed(0)
+{
+    m_pool.setMaxThreadCount(qMax(1, threads));
+    QDir().mkpath(m_directory);
+}
+
+ImageSequenceEncoder::~ImageSequenceEncoder()
+{
+    m_pool.waitForDone();
+}
+
+void ImageSequenceEncoder::encode(int frame, const QImage &image)
+{
+    QElapsedTimer timer;
+    timer.start();
+    m_slots.acquire();
+    m_waitTime += timer.nsecsElapsed() / 1000;
+    m_pool.start(new Task(this, frame, image));
+}
+
+bool ImageSequenceEncoder::finish()
+{
+    m_pool.waitForDone();
+    return m_failed.load() == 0;
+}
+
+QString ImageSequenceEncoder::fileName(int frame) const
+{
+    return QStringLiteral("%1/%2_%3.%4").arg(m_directory, m_baseName).arg(frame, 5, 10, QLatin1Char('0'))
+        .arg(QString::fromLatin1(m_format));
+}
+
+void ImageSequenceEncoder::write(int frame, const QImage &image)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    QImageWriter writer(fileName(frame), m_format);
+    int quality = m_quality;
+    if (m_compression >= 0) {
+        writer.setCompression(m_compression);
+        // The png writer only takes the zlib level through the quality, 100 is level 0
+        if (m_format == "png") {
+            quality = 100 - (qBound(0, m_compression, 9) * 91 + 8) / 9;
+        }
+    }
+    writer.setQuality(quality);
+    if (!writer.write(image)) {
+        qDebug() << "Failed to write" << writer.fileName() << writer.errorString();
+        m_failed.ref();
+    }
+
+    m_encodeTime.fetchAndAddRelaxed(timer.nsecsElapsed() / 1000);
+    m_slots.release();
+}
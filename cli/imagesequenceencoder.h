@@ -0,0 +1,76 @@
+/*
+Copyright (C) 2019  Akhil K Gangadharan <helloimakhil@gmail.com>
+This file is part of Kdenlive. See www.kdenlive.org.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of
+the License or (at your option) version 3 or any later version
+accepted by the membership of KDE e.V. (or its successor approved
+by the membership of KDE e.V.), which shall act as a proxy
+defined in Section 14 of version 3 of the license.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef IMAGESEQUENCEENCODER_H
+#define IMAGESEQUENCEENCODER_H
+
+#include <QAtomicInt>
+#include <QImage>
+#include <QSemaphore>
+#include <QString>
+#include <QThreadPool>
+
+/*
+ * Compresses and writes frames as numbered image files on a thread pool, so
+ * rendering goes on while earlier frames are encoded. At most maxPending frames
+ * wait for or are in encoding, encode() blocks beyond that, which bounds the
+ * memory held by frames.
+*/
+class ImageSequenceEncoder
+{
+public:
+    ImageSequenceEncoder(const QString &directory, const QString &baseName, const QByteArray &format,
+                         int threads = QThread::idealThreadCount(), int maxPending = 0);
+    ~ImageSequenceEncoder();
+
+    // 0-100, for lossy formats such as jpg, -1 is the format's default
+    void setQuality(int quality) { m_quality = quality; }
+    // 0 (none) to 9 (best), for png and tiff, -1 is the format's default
+    void setCompression(int compression) { m_compression = compression; }
+
+    void encode(int frame, const QImage &image);
+    // Waits for all frames, false if any could not be written
+    bool finish();
+    QString fileName(int frame) const;
+
+    // Encoding time summed over all threads
+    qint64 encodeTime() const { return m_encodeTime.load() / 1000; }
+    // Time encode() was blocked by a full queue
+    qint64 waitTime() const { return m_waitTime / 1000; }
+    int failedCount() const { return m_failed.load(); }
+
+private:
+    class Task;
+    void write(int frame, const QImage &image);
+
+    QString m_directory;
+    QString m_baseName;
+    QByteArray m_format;
+    int m_quality;
+    int m_compression;
+    QThreadPool m_pool;
+    QSemaphore m_slots;
+    QAtomicInteger<qint64> m_encodeTime;
+    qint64 m_waitTime;
+    QAtomicInt m_failed;
+};
+
+#endif // IMAGESEQUENCEENCODER_H
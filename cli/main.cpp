@@ -20,13 +20,35 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "qmlrender.h"
+#include "rawvideowriter.h"
+#include "imagesequenceencoder.h"
+#include <QElapsedTimer>
 #include <QApplication>
 #include <QCommandLineParser>
 #include <QCommandLineOption>
 #include <QProcess>
+#include "qmlparallelrenderer.h"
+#include <memory>
+
+// Value of a command line option, for the few that must be known before QApplication exists
+static QByteArray earlyOption(int argc, char *argv[], const QList<QByteArray> &names)
+{
+    for (int i = 1; i < argc - 1; ++i) {
+        if (names.contains(QByteArray(argv[i]))) {
+            return QByteArray(argv[i + 1]);
+        }
+    }
+    return QByteArray();
+}
 
 int main(int argc, char *argv[])
 {
+    // The scene is scaled through the windows' device pixel ratio, which comes from the platform
+    const QByteArray dprValue = earlyOption(argc, argv, QList<QByteArray>() << "-D" << "--devicepixelratio");
+    if (!dprValue.isEmpty() && dprValue.toDouble() != 1.0) {
+        qputenv("QT_SCALE_FACTOR", dprValue);
+    }
+
     QApplication app(argc, argv);
     QCoreApplication::setApplicationName("QmlRenderer");
     QCoreApplication::setApplicationVersion(QT_VERSION_STR);
@@ -59,7 +81,7 @@ int main(int argc, char *argv[])
     duration.setDefaultValue("1000");
     parser.addOption(duration);
 
-    QCommandLineOption  fps("F", QCoreApplication::translate("main", "Set FPS of output video" ), "fps");
+    QCommandLineOption  fps("F", QCoreApplication::translate("main", "Set FPS of output video, a whole number or a fraction such as 30000/1001" ), "fps");
     fps.setDefaultValue("25");
     parser.addOption(fps);
 
@@ -71,21 +93,168 @@ int main(int argc, char *argv[])
     frametime.setDefaultValue("1000");
     parser.addOption(frametime);
 
+    QCommandLineOption  range(QStringList() << "r" << "range", QCoreApplication::translate("main", "Render only frames first to last (inclusive), eg: 25-49" ), "first-last");
+    parser.addOption(range);
+
+    QCommandLineOption  jobs(QStringList() << "j" << "jobs", QCoreApplication::translate("main", "Split the frames across N parallel renderers" ), "N");
+    jobs.setDefaultValue("1");
+    parser.addOption(jobs);
+
+    QCommandLineOption  rawvideo("rawvideo", QCoreApplication::translate("main", "Stream all frames as raw video to output, - for stdout or the path of a named pipe" ), "output");
+    parser.addOption(rawvideo);
+
+    QCommandLineOption  pixelFormat("pixfmt", QCoreApplication::translate("main", "Set pixel format of raw video: rgba, bgra, rgb0, bgr0, yuv420p or yuv422p" ), "pixfmt");
+    pixelFormat.setDefaultValue("rgba");
+    parser.addOption(pixelFormat);
+
+    QCommandLineOption  quality(QStringList() << "q" << "quality", QCoreApplication::translate("main", "Set quality (0-100) of lossy output formats" ), "quality");
+    quality.setDefaultValue("-1");
+    parser.addOption(quality);
+
+    QCommandLineOption  compression("compression", QCoreApplication::translate("main", "Set compression level (0-9) of png/tiff output" ), "level");
+    compression.setDefaultValue("-1");
+    parser.addOption(compression);
+
+    QCommandLineOption  encoders("encoders", QCoreApplication::translate("main", "Set number of threads encoding output images" ), "threads");
+    encoders.setDefaultValue(QString::number(QThread::idealThreadCount()));
+    parser.addOption(encoders);
+
+    QCommandLineOption  cacheDir(QStringList() << "c" << "cachedir", QCoreApplication::translate("main", "Set directory of the QML compilation cache" ), "cachedir");
+    parser.addOption(cacheDir);
+
+    parser.addPositionalArgument("precompile", QCoreApplication::translate("main", "precompile <directory> : compile all templates below directory into the compilation cache" ), "[precompile <directory>]");
+
     parser.process(app);
 
-    if(parser.value(file).isNull() || parser.value(odir).isNull()) {
+    if (parser.isSet(cacheDir) && !QmlComponentCache::setDiskCacheDirectory(parser.value(cacheDir))) {
+        qDebug() << "The QML compilation cache directory can not be changed with this Qt version, it is"
+                 << QmlComponentCache::diskCacheDirectory();
+        return 1;
+    }
+
+    const QStringList arguments = parser.positionalArguments();
+    if (!arguments.isEmpty()) {
+        if (arguments.first() != "precompile" || arguments.size() != 2) {
+            parser.showHelp(1);
+        }
+        return QmlRender::precompile(arguments.at(1)) ? 0 : 1;
+    }
+
+    if(parser.value(file).isNull() || (parser.value(odir).isNull() && !parser.isSet(rawvideo))) {
         qDebug() << "Missing arguments";
         return 1;
     }
 
     QStringList frameSizeList = parser.value(size).split("x");                      // for 1280x720, frameSizeList will contain ["1280", "720"]
-    QSize frameSize(frameSizeList.at(0).toInt(), frameSizeList.at(1).toInt());
+    const QSize frameSize = frameSizeList.size() == 2 ? QSize(frameSizeList.at(0).toInt(), frameSizeList.at(1).toInt()) : QSize();
+    if (frameSize.isEmpty()) {
+        qDebug() << "Invalid size" << parser.value(size);
+        return 1;
+    }
+    const qreal dpr = parser.value(devicePRatio).toDouble();
+    const QSize outputSize = frameSize * dpr;
 
+    const QStringList fpsList = parser.value(fps).split("/");
+    const int fpsNumerator = fpsList.at(0).toInt();
+    const int fpsDenominator = fpsList.size() > 1 ? fpsList.at(1).toInt() : 1;
+    if (fpsNumerator <= 0 || fpsDenominator <= 0) {
+        qDebug() << "Invalid fps" << parser.value(fps);
+        return 1;
+    }
+    const qint64 durationMs = parser.value(duration).toLongLong();
+    const int frames = int(durationMs * fpsNumerator / (qint64(fpsDenominator) * 1000));
+    // Renderer duration is in whole seconds, the frame range decides where to stop
+    const int durationSeconds = int((durationMs + 999) / 1000);
+    const int framesPerSecond = qMax(1, qRound(qreal(fpsNumerator) / fpsDenominator));
+
+    int first = 0;
+    int last = frames - 1;
     bool ifSingleFrame = parser.value(singleframe)=="true"? true:false ;
+    if (ifSingleFrame) {
+        first = last = qMin(frames - 1, int(parser.value(frametime).toLongLong() * fpsNumerator / (qint64(fpsDenominator) * 1000)));
+    } else if (parser.isSet(range)) {
+        const QStringList rangeList = parser.value(range).split("-");
+        first = rangeList.at(0).toInt();
+        last = qMin(last, rangeList.value(1, rangeList.at(0)).toInt());
+    }
+    if (first < 0 || first > last) {
+        qDebug() << "Nothing to render: frames" << first << "to" << last << "of" << frames;
+        return 1;
+    }
+
+    const int jobCount = qMax(1, parser.value(jobs).toInt());
+    // Only the renderer in use is created, each costs a GL context, window and render thread
+    std::unique_ptr<QmlRender> w;
+    std::unique_ptr<QmlParallelRenderer> parallel;
+    if (jobCount > 1) {
+        parallel = std::make_unique<QmlParallelRenderer>(parser.value(file), framesPerSecond, durationSeconds, jobCount);
+        parallel->setFrameRate(fpsNumerator, fpsDenominator);
+        parallel->setDevicePixelRatio(dpr);
+    } else {
+        w = std::make_unique<QmlRender>(parser.value(file), framesPerSecond, durationSeconds);
+        w->renderer->setFrameRate(fpsNumerator, fpsDenominator);
+        w->renderer->setDevicePixelRatio(dpr);
+    }
+
+    QElapsedTimer timer;
+    qint64 sinkTime = 0;
+    // Renders first to last in chunks, stops early once sink returns false
+    auto renderFrames = [&](QImage::Format imageFormat, const std::function<bool(int, const QImage &)> &sink) {
+        bool go = true;
+        const int chunk = jobCount > 1 ? last - first + 1 : framesPerSecond;
+        timer.start();
+        for (int start = first; start <= last && go; start += chunk) {
+            const int end = qMin(start + chunk - 1, last);
+            const QmlRenderer::FrameSink timedSink = [&](int frame, const QImage &image) {
+                QElapsedTimer sinkTimer;
+                sinkTimer.start();
+                go = go && sink(frame, image);
+                sinkTime += sinkTimer.elapsed();
+            };
+            if (jobCount > 1) {
+                parallel->renderRange(frameSize.width(), frameSize.height(), imageFormat, start, end, timedSink);
+            } else {
+                w->renderer->renderRange(frameSize.width(), frameSize.height(), imageFormat, start, end, timedSink);
+            }
+        }
+        return go;
+    };
+
+    if (parser.isSet(rawvideo)) {
+        QmlPixelConverter::PixelFormat rawFormat;
+        if (!RawVideoWriter::pixelFormat(parser.value(pixelFormat), &rawFormat)) {
+            qDebug() << "Unknown pixel format" << parser.value(pixelFormat);
+            return 1;
+        }
+        RawVideoWriter writer(rawFormat, outputSize);
+        // Logging goes to stderr, stdout only carries frames
+        qDebug().noquote() << "ffmpeg" << writer.ffmpegArguments(fpsNumerator, fpsDenominator) << "output.mp4";
+        if (!writer.open(parser.value(rawvideo))) {
+            return 1;
+        }
+
+        const bool written = renderFrames(QImage::Format_RGBA8888_Premultiplied, [&](int, const QImage &image) {
+            // Blocks while the reader is busy, which holds back the renderer
+            return writer.write(image);
+        });
+        qDebug() << last - first + 1 << "frames in" << timer.elapsed() << "ms, writing" << sinkTime << "ms";
+        return written ? 0 : 1;
+    }
+
+    // Frames are compressed on other threads while the next ones render
+    ImageSequenceEncoder encoder(parser.value(odir), outputName, parser.value(format).toLatin1(), parser.value(encoders).toInt());
+    encoder.setQuality(parser.value(quality).toInt());
+    encoder.setCompression(parser.value(compression).toInt());
+
+    renderFrames(QImage::Format_ARGB32, [&](int frame, const QImage &image) {
+        encoder.encode(frame, image);
+        return true;
+    });
+    const qint64 renderDone = timer.elapsed();
+    const bool written = encoder.finish();
 
-    // TODO : Extend functionality
-    QmlRender w(QString(parser.value(file)));
-    QImage img = w.renderer->render(720, 596, QImage::Format_ARGB32);
-    img.save(parser.value(odir));
-    return app.exec();
+    qDebug() << last - first + 1 << "frames in" << timer.elapsed() << "ms: rendering" << renderDone - encoder.waitTime()
+             << "ms, waiting for encoders" << encoder.waitTime() << "ms, encoding" << encoder.encodeTime()
+             << "ms over" << parser.value(encoders).toInt() << "threads";
+    return written ? 0 : 1;
 }
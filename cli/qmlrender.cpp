@@ -20,15 +20,46 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "qmlrender.h"
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QQmlEngine>
 
-QmlRender::QmlRender(QString filename, QObject *parent)
+QmlRender::QmlRender(QString filename, int fps, int duration, QObject *parent)
     : QObject(parent)
     , m_filename(filename)
 {
-    renderer = std::make_unique<QmlRenderer>(filename, 25, 0);
+    renderer = std::make_unique<QmlRenderer>(filename, fps, duration);
 }
 
 QmlRender::~QmlRender()
 {
 }
 
+
+bool QmlRender::precompile(const QString &directory)
+{
+    if (!QFileInfo(directory).isDir()) {
+        qDebug() << "Not a directory:" << directory;
+        return false;
+    }
+
+    QQmlEngine engine;
+    QmlComponentCache *cache = QmlComponentCache::forEngine(&engine);
+    int failed = 0;
+    QDirIterator it(directory, QStringList() << "*.qml", QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        const QUrl url = QUrl::fromLocalFile(it.next());
+        QQmlComponent *component = cache->component(url);
+        if (component->isError()) {
+            qDebug() << "Failed:" << url.toLocalFile() << component->errors();
+            failed++;
+            continue;
+        }
+        // Whether the engine used a cache file is not known, only whether there is one now
+        const bool written = QFileInfo::exists(QmlComponentCache::diskCacheFile(url));
+        qDebug() << url.toLocalFile() << "- loaded as" << QmlComponentCache::loadSourceName(cache->lastLoadSource())
+                 << (written ? "- cache file present" : "- no cache file written");
+    }
+    qDebug() << cache->count() - failed << "templates loaded, the engine keeps its cache files in" << QmlComponentCache::diskCacheDirectory();
+    return failed == 0;
+}
@@ -30,9 +30,12 @@ class QmlRender : public QObject
     Q_OBJECT
 
 public:
-    explicit QmlRender(QString filename, QObject *parent = nullptr);
+    explicit QmlRender(QString filename, int fps = 25, int duration = 0, QObject *parent = nullptr);
     ~QmlRender();
 
+    // Compiles every template below directory into the QML disk cache
+    static bool precompile(const QString &directory);
+
     std::unique_ptr<QmlRenderer> renderer;
 private:
     QString m_filename;
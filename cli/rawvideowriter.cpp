@@ -0,0 +1,132 @@
+/*
+Copyright (C) 2019  Akhil K Gangadharan <helloimakhil@gmail.com>
+This file is part of Kdenlive. See www.kdenlive.org.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of
+the License or (at your option) version 3 or any later version
+accepted by the membership of KDE e.V. (or its successor approved
+by the membership of KDE e.V.), which shall act as a proxy
+defined in Section 14 of version 3 of the license.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "rawvideowriter.h"
+#include <QDebug>
+#include <cstdio>
+#include <csignal>
+
+RawVideoWriter::RawVideoWriter(QmlPixelConverter::PixelFormat format, const QSize &size)
+    : m_format(format)
+    , m_size(size)
+{
+    // Planes follow each other without padding, the layout rawvideo expects
+    int bytes = 0;
+    QVector<int> offsets;
+    for (int i = 0; i < QmlPixelConverter::planeCount(format); ++i) {
+        const QSize planeSize = QmlPixelConverter::planeSize(format, i, size);
+        const int bytesPerPixel = QmlPixelConverter::planeCount(format) == 1 ? 4 : 1;
+        offsets << bytes;
+        m_planes << QmlPixelConverter::Plane{nullptr, planeSize.width() * bytesPerPixel};
+        bytes += planeSize.width() * bytesPerPixel * planeSize.height();
+    }
+    m_frame.resize(bytes);
+    for (int i = 0; i < m_planes.size(); ++i) {
+        m_planes[i].data = reinterpret_cast<uchar *>(m_frame.data()) + offsets.at(i);
+    }
+}
+
+RawVideoWriter::~RawVideoWriter()
+{
+    m_file.close();
+}
+
+bool RawVideoWriter::open(const QString &output)
+{
+#ifdef SIGPIPE
+    // A reader that quits early shows up as a failed write instead of killing us
+    signal(SIGPIPE, SIG_IGN);
+#endif
+    bool opened;
+    if (output == QLatin1String("-")) {
+        opened = m_file.open(fileno(stdout), QIODevice::WriteOnly | QIODevice::Unbuffered);
+    } else {
+        m_file.setFileName(output);
+        opened = m_file.open(QIODevice::WriteOnly | QIODevice::Unbuffered);
+    }
+    if (!opened) {
+        qDebug() << "Cannot open raw video output" << output << m_file.errorString();
+    }
+    return opened;
+}
+
+bool RawVideoWriter::write(const QImage &frame)
+{
+    Q_ASSERT(frame.format() == QImage::Format_RGBA8888_Premultiplied && frame.size() == m_size);
+    QmlPixelConverter::convert(frame.constBits(), frame.bytesPerLine(), m_size, false, m_format, m_planes.constData());
+
+    qint64 written = 0;
+    while (written < m_frame.size()) {
+        const qint64 bytes = m_file.write(m_frame.constData() + written, m_frame.size() - written);
+        if (bytes <= 0) {
+            qDebug() << "Raw video output closed:" << m_file.errorString();
+            return false;
+        }
+        written += bytes;
+    }
+    return true;
+}
+
+QString RawVideoWriter::ffmpegArguments(int fpsNumerator, int fpsDenominator) const
+{
+    QString arguments = QStringLiteral("-f rawvideo -pix_fmt %1 -s %2x%3 -framerate %4/%5")
+        .arg(QLatin1String(ffmpegPixelFormat(m_format))).arg(m_size.width()).arg(m_size.height())
+        .arg(fpsNumerator).arg(fpsDenominator);
+    if (QmlPixelConverter::planeCount(m_format) > 1) {
+        arguments += QStringLiteral(" -color_range tv -colorspace bt709");
+    }
+    return arguments + QStringLiteral(" -i -");
+}
+
+bool RawVideoWriter::pixelFormat(const QString &name, QmlPixelConverter::PixelFormat *format)
+{
+    static const QmlPixelConverter::PixelFormat formats[] = {
+        QmlPixelConverter::RGBA8888, QmlPixelConverter::BGRA8888, QmlPixelConverter::RGBX8888,
+        QmlPixelConverter::BGRX8888, QmlPixelConverter::YUV420P, QmlPixelConverter::YUV422P
+    };
+    for (QmlPixelConverter::PixelFormat candidate : formats) {
+        if (name == QLatin1String(ffmpegPixelFormat(candidate))) {
+            *format = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *RawVideoWriter::ffmpegPixelFormat(QmlPixelConverter::PixelFormat format)
+{
+    switch (format) {
+    case QmlPixelConverter::RGBA8888:
+        return "rgba";
+    case QmlPixelConverter::BGRA8888:
+        return "bgra";
+    case QmlPixelConverter::RGBX8888:
+        return "rgb0";
+    case QmlPixelConverter::BGRX8888:
+        return "bgr0";
+    case QmlPixelConverter::YUV420P:
+        return "yuv420p";
+    case QmlPixelConverter::YUV422P:
+        return "yuv422p";
+    default:
+        return "";
+    }
+}
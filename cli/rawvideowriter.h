@@ -0,0 +1,61 @@
+/*
+Copyright (C) 2019  Akhil K Gangadharan <helloimakhil@gmail.com>
+This file is part of Kdenlive. See www.kdenlive.org.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of
+the License or (at your option) version 3 or any later version
+accepted by the membership of KDE e.V. (or its successor approved
+by the membership of KDE e.V.), which shall act as a proxy
+defined in Section 14 of version 3 of the license.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef RAWVIDEOWRITER_H
+#define RAWVIDEOWRITER_H
+
+#include "qmlpixelconverter.h"
+#include <QFile>
+#include <QImage>
+#include <QVector>
+
+/*
+ * Streams frames as headerless raw video to stdout or a named pipe, to be
+ * read by e.g. ffmpeg -f rawvideo (see ffmpegArguments()). Writes block until
+ * the reader has taken the data, so rendering never runs ahead of encoding by
+ * more than the pipe buffer.
+*/
+class RawVideoWriter
+{
+public:
+    RawVideoWriter(QmlPixelConverter::PixelFormat format, const QSize &size);
+    ~RawVideoWriter();
+
+    // Output "-" is stdout, anything else a file or named pipe (opening a pipe waits for its reader)
+    bool open(const QString &output);
+    // Converts a premultiplied RGBA8888 frame, false once the reader went away
+    bool write(const QImage &frame);
+    QString ffmpegArguments(int fpsNumerator, int fpsDenominator) const;
+    int frameBytes() const { return m_frame.size(); }
+
+    static bool pixelFormat(const QString &name, QmlPixelConverter::PixelFormat *format);
+
+private:
+    static const char *ffmpegPixelFormat(QmlPixelConverter::PixelFormat format);
+
+    QmlPixelConverter::PixelFormat m_format;
+    QSize m_size;
+    QFile m_file;
+    QByteArray m_frame;
+    QVector<QmlPixelConverter::Plane> m_planes;
+};
+
+#endif // RAWVIDEOWRITER_H
@@ -1,8 +1,10 @@
 TEMPLATE = subdirs
 CONFIG += ordered
-SUBDIRS = src/QmlRenderer.pro cli/QmlRender.pro test/renderertest.pro
+SUBDIRS = src/QmlRenderer.pro cli/QmlRender.pro test/renderertest.pro test/golden/golden.pro bench/renderbench.pro
 cli.depends = src
 test.depends = src
+bench.depends = src
+golden.depends = src
 
 # Copies directory containing reference_output frames and lib_output directory (used in unit test) to the build directory
 copydata.commands = $(COPY_DIR) $$PWD/test/reference_output $$OUT_PWD;  $(COPY_DIR) $$PWD/test/lib_output $$OUT_PWD
@@ -1,9 +1,16 @@
 TEMPLATE = lib
 TARGET = QmlRenderer
 QT = core qml opengl quick 
+# QUnifiedTimer and QQmlAnimationTimer, to start queued animations before the clock moves
+QT += core-private qml-private
 DEFINES += QMLRENDERER_LIBRARY
-SOURCES += qmlrenderer.cpp qmlanimationdriver.cpp qmlcorerenderer.cpp
+SOURCES += qmlrenderer.cpp qmlanimationdriver.cpp qmlcorerenderer.cpp qmlcomponentcache.cpp \
+    qmlpixelconverter.cpp qmlparallelrenderer.cpp \
+    qmlscenesnapshot.cpp qmlframecache.cpp qmldirtytracker.cpp \
+    qmlrendererpool.cpp qmlrenderstats.cpp
 HEADERS += qmlrenderer.h qmlrenderer_global.h qmlanimationdriver.h \
-    qmlcorerenderer.h
+    qmlcorerenderer.h qmlcomponentcache.h qmlpixelconverter.h \
+    qmlparallelrenderer.h qmlscenesnapshot.h qmlframecache.h \
+    qmldirtytracker.h qmlrendererpool.h qmlrenderstats.h
 win32: DESTDIR = ../bin
 else: DESTDIR = ../lib
@@ -21,20 +21,32 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "qmlanimationdriver.h"
 
-QmlAnimationDriver::QmlAnimationDriver(int msPerStep)
-    : m_step(msPerStep)
-    , m_elapsed(0)
+QmlAnimationDriver::QmlAnimationDriver(int fpsNumerator, int fpsDenominator)
+    : m_fpsNumerator(fpsNumerator)
+    , m_fpsDenominator(fpsDenominator)
+    , m_frame(0)
 {
+    Q_ASSERT(fpsNumerator > 0 && fpsDenominator > 0);
+}
+
+qint64 QmlAnimationDriver::frameTime(qint64 frame, int fpsNumerator, int fpsDenominator)
+{
+    return frame * fpsDenominator * 1000 / fpsNumerator;
 }
 
 void QmlAnimationDriver::advance()
 {
-    m_elapsed += m_step;
+    m_frame++;
     advanceAnimation();
 }
 
-qint64 QmlAnimationDriver::elapsed() const
+void QmlAnimationDriver::seekToFrame(qint64 frame)
 {
-    return m_elapsed;
+    m_frame = frame;
+    advanceAnimation();
 }
 
+qint64 QmlAnimationDriver::elapsed() const
+{
+    return frameTime(m_frame, m_fpsNumerator, m_fpsDenominator);
+}
@@ -23,16 +23,26 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define QMLANIMATIONDRIVER_H
 #include <QtCore/QAnimationDriver>
 
+/*
+ * Drives QML animations from a frame counter instead of the wall clock. The
+ * frame rate is a fraction (e.g. 30000/1001) and the elapsed time is computed
+ * from the frame number, so rounding never accumulates over a clip.
+*/
 class QmlAnimationDriver : public QAnimationDriver
 {
 public:
-    QmlAnimationDriver(int msPerStep);
+    QmlAnimationDriver(int fpsNumerator, int fpsDenominator = 1);
 
     void advance() override;
     qint64 elapsed() const override;
+    // Jumps to frame in a single animation step
+    void seekToFrame(qint64 frame);
+    qint64 frame() const { return m_frame; }
+    static qint64 frameTime(qint64 frame, int fpsNumerator, int fpsDenominator);
 private:
-    int m_step;
-    qint64 m_elapsed;
+    int m_fpsNumerator;
+    int m_fpsDenominator;
+    qint64 m_frame;
 };
 
 #endif // QMLANIMATIONDRIVER_H
@@ -0,0 +1,160 @@
+/*
+Copyright (C) 2019  Akhil K Gangadharan <helloimakhil@gmail.com>
+This file is part of Kdenlive. See www.kdenlive.org.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of
+the License or (at your option) version 3 or any later version
+accepted by the membership of KDE e.V. (or its successor approved
+by the membership of KDE e.V.), which shall act as a proxy
+defined in Section 14 of version 3 of the license.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "qmlcomponentcache.h"
+#include <QDebug>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
+
+QmlComponentCache::QmlComponentCache(QQmlEngine *engine)
+    : QObject(engine)
+    , m_engine(engine)
+    , m_lastLoadSource(NotLoaded)
+{
+}
+
+bool QmlComponentCache::setDiskCacheDirectory(const QString &path)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    QDir().mkpath(path);
+    qputenv("QML_DISK_CACHE_PATH", QFile::encodeName(QDir(path).absolutePath()));
+    return true;
+#else
+    // Qt 5 always keeps the disk cache in the cache location
+    Q_UNUSED(path);
+    return false;
+#endif
+}
+
+QString QmlComponentCache::diskCacheDirectory()
+{
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    const QString path = QFile::decodeName(qgetenv("QML_DISK_CACHE_PATH"));
+    if (!path.isEmpty()) {
+        return path;
+    }
+#endif
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/qmlcache");
+}
+
+QString QmlComponentCache::diskCacheFile(const QUrl &url)
+{
+    // Same naming as the engine: SHA-1 of the source path, suffix with a 'c' appended
+    const QString sourcePath = url.toLocalFile();
+    const QString suffix = QFileInfo(sourcePath + QLatin1Char('c')).completeSuffix();
+    const QByteArray name = QCryptographicHash::hash(sourcePath.toUtf8(), QCryptographicHash::Sha1).toHex();
+    return diskCacheDirectory() + QLatin1Char('/') + QString::fromLatin1(name) + QLatin1Char('.') + suffix;
+}
+
+const char *QmlComponentCache::loadSourceName(LoadSource source)
+{
+    switch (source) {
+    case Compiled:
+        return "compiled";
+    case MemoryCache:
+        return "memory cache";
+    case DiskCache:
+        return "disk cache (cache file found)";
+    case Resource:
+        return "resource (precompiled if built with qmlcachegen)";
+    default:
+        return "not loaded";
+    }
+}
+
+QmlComponentCache *QmlComponentCache::forEngine(QQmlEngine *engine)
+{
+    Q_ASSERT(engine != nullptr);
+    QmlComponentCache *cache = engine->findChild<QmlComponentCache *>(QString(), Qt::FindDirectChildrenOnly);
+    if (!cache) {
+        cache = new QmlComponentCache(engine);
+    }
+    return cache;
+}
+
+QQmlComponent *QmlComponentCache::component(const QUrl &url)
+{
+    QDateTime lastModified;
+    if (url.isLocalFile()) {
+        lastModified = QFileInfo(url.toLocalFile()).lastModified();
+    }
+
+    auto it = m_components.find(url);
+    if (it != m_components.end()) {
+        if (it->lastModified == lastModified && !it->component->isError()) {
+            m_lastLoadSource = MemoryCache;
+            return it->component;
+        }
+        // Objects already created from the stale component do not depend on it,
+        // dropping it lets the engine forget the old compilation unit
+        delete it->component;
+        m_components.erase(it);
+        m_engine->trimComponentCache();
+    }
+
+    // A cache file at least as new as the source is loaded instead of compiling,
+    // unless the engine finds it stale or built by another Qt version
+    if (url.scheme() == QLatin1String("qrc")) {
+        m_lastLoadSource = Resource;
+    } else {
+        const QFileInfo cacheFile(url.isLocalFile() ? diskCacheFile(url) : QString());
+        const bool cached = cacheFile.exists() && cacheFile.lastModified() >= lastModified
+            && qEnvironmentVariableIsEmpty("QML_DISABLE_DISK_CACHE");
+        m_lastLoadSource = cached ? DiskCache : Compiled;
+    }
+    QQmlComponent *component = new QQmlComponent(m_engine, url, QQmlComponent::PreferSynchronous, this);
+    m_components.insert(url, Entry{component, lastModified});
+    return component;
+}
+
+int QmlComponentCache::preload(const QList<QUrl> &urls)
+{
+    int ready = 0;
+    for (const QUrl &url : urls) {
+        QQmlComponent *loaded = component(url);
+        if (loaded->isReady()) {
+            ready++;
+        } else {
+            qWarning() << "Cannot preload" << url << loaded->errors();
+        }
+    }
+    return ready;
+}
+
+void QmlComponentCache::remove(const QUrl &url)
+{
+    auto it = m_components.find(url);
+    if (it != m_components.end()) {
+        delete it->component;
+        m_components.erase(it);
+    }
+}
+
+void QmlComponentCache::clear()
+{
+    for (const Entry &entry : qAsConst(m_components)) {
+        delete entry.component;
+    }
+    m_components.clear();
+}
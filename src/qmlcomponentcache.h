@@ -0,0 +1,96 @@
+/*
+Copyright (C) 2019  Akhil K Gangadharan <helloimakhil@gmail.com>
+This file is part of Kdenlive. See www.kdenlive.org.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of
+the License or (at your option) version 3 or any later version
+accepted by the membership of KDE e.V. (or its successor approved
+by the membership of KDE e.V.), which shall act as a proxy
+defined in Section 14 of version 3 of the license.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef QMLCOMPONENTCACHE_H
+#define QMLCOMPONENTCACHE_H
+
+#include <QObject>
+#include <QHash>
+#include <QUrl>
+#include <QDateTime>
+#include <QQmlComponent>
+#include <QQmlEngine>
+
+/*
+ * Keeps compiled QQmlComponents around per QML URL, so a template that is
+ * instantiated many times is only compiled once. There is one cache per
+ * QQmlEngine (a component cannot be used with another engine), owned by and
+ * shared through the engine. Local files are recompiled when their
+ * modification time changes.
+ *
+ * Below that, the engine itself avoids compiling: local files are looked up in
+ * the QML disk cache (see setDiskCacheDirectory()) and templates in resources
+ * can be compiled ahead of time by qmlcachegen (CONFIG += qtquickcompiler).
+*/
+class QmlComponentCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    /*
+     * Where the component of the last component() call came from. Only
+     * MemoryCache is certain: the engine does not tell whether it used a cache
+     * file, so DiskCache means a cache file at least as new as the source was
+     * there (a stale or incompatible one is recompiled all the same), and every
+     * qrc: URL is reported as Resource, compiled ahead of time or not.
+     */
+    enum LoadSource {
+        NotLoaded,
+        Compiled,       // no cache file, compiled from source
+        MemoryCache,    // this cache
+        DiskCache,      // probably the compilation unit of the QML disk cache
+        Resource        // resource, compiled ahead of time when built with qmlcachegen
+    };
+
+    static QmlComponentCache *forEngine(QQmlEngine *engine);
+    /*
+     * Keeps the QML disk cache in path instead of the application's cache
+     * location. Has to be called before the first engine is created. Returns
+     * false on Qt 5, whose engine does not read QML_DISK_CACHE_PATH.
+     */
+    static bool setDiskCacheDirectory(const QString &path);
+    static QString diskCacheDirectory();
+    // The disk cache file the engine uses for the local file url
+    static QString diskCacheFile(const QUrl &url);
+    static const char *loadSourceName(LoadSource source);
+
+    QQmlComponent *component(const QUrl &url);
+    // Compiles urls ahead of their first use, returns how many are ready
+    int preload(const QList<QUrl> &urls);
+    void remove(const QUrl &url);
+    void clear();
+    int count() const { return m_components.count(); }
+    LoadSource lastLoadSource() const { return m_lastLoadSource; }
+
+private:
+    explicit QmlComponentCache(QQmlEngine *engine);
+
+    struct Entry {
+        QQmlComponent *component;
+        QDateTime lastModified;
+    };
+
+    QQmlEngine *m_engine;
+    QHash<QUrl, Entry> m_components;
+    LoadSource m_lastLoadSource;
+};
+
+#endif // QMLCOMPONENTCACHE_H
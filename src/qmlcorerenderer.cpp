@@ -21,7 +21,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "qmlcorerenderer.h"
 #include "qmlanimationdriver.h"
+#include "qmlpixelconverter.h"
 #include <memory>
+#include <cstring>
 
 #include <QCoreApplication>
 #include <QOpenGLContext>
@@ -31,6 +33,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QThread>
 #include <QOpenGLFunctions>
 
+// Two buffers deliver every frame one frame late: the readback of frame N is
+// mapped after frame N + 1 has been rendered
+static const int READBACK_RING_SIZE = 2;
+
 QmlCoreRenderer::QmlCoreRenderer(QObject *parent)
     : QObject(parent),
     m_fbo(nullptr),
@@ -38,7 +44,15 @@ QmlCoreRenderer::QmlCoreRenderer(QObject *parent)
     m_offscreenSurface(nullptr),
     m_context(nullptr),
     m_quickWindow(nullptr),
-    m_renderControl(nullptr)
+    m_renderControl(nullptr),
+    m_asyncReadback(false),
+    m_pipelined(false),
+    m_frameNumber(0),
+    m_readbacks(READBACK_RING_SIZE, Readback{nullptr, QSize(), QRect(), -1}),
+    m_nextReadback(0),
+    m_hasTarget(false),
+    m_targetPixelFormat(-1),
+    m_stats(nullptr)
     {}
 
 QmlCoreRenderer::~QmlCoreRenderer()
@@ -56,11 +70,14 @@ bool QmlCoreRenderer::event(QEvent *e)
             render(&lock);
             return true;
         case RESIZE:
-            // TODO
+            resize();
             return true;
         case STOP:
             cleanup();
             return true;
+        case FLUSH:
+            flushReadbacks();
+            return true;
         default:
             return QObject::event(e);
     }
@@ -72,15 +89,35 @@ void QmlCoreRenderer::init()
     m_renderControl->initialize(m_context);
 }
 
+void QmlCoreRenderer::resize()
+{
+    // Reallocates the framebuffer for the new size or device pixel ratio right away,
+    // the previous image no longer matches, so the next readback is a full one
+    if (m_context->makeCurrent(m_offscreenSurface)) {
+        ensureFbo();
+    } else {
+        qWarning("!!!!! ERROR : Failed to make context current on render thread");
+    }
+    m_image = QImage();
+    m_cond.wakeOne();
+}
+
 void QmlCoreRenderer::cleanup()
 {
     m_context->makeCurrent(m_offscreenSurface);
     m_renderControl->invalidate();
+    for (Readback &readback : m_readbacks) {
+        delete readback.buffer;
+        readback.buffer = nullptr;
+        readback.frame = -1;
+    }
     delete m_fbo;
     m_fbo = nullptr;
     m_context->doneCurrent();
 
-    m_animationDriver->uninstall();
+    if (m_animationDriver) {
+        m_animationDriver->uninstall();
+    }
     m_context->moveToThread(QCoreApplication::instance()->thread());
     m_cond.wakeOne();
 }
@@ -106,21 +143,245 @@ void QmlCoreRenderer::render(QMutexLocker *lock)
 {
     if (!m_context->makeCurrent(m_offscreenSurface)) {
         qWarning("!!!!! ERROR : Failed to make context current on render thread");
+        m_cond.wakeOne();
         return;
     }
 
     ensureFbo();
-    m_renderControl->sync();
+    // Everything below only reads state captured here once the main thread runs again
+    const int frame = m_frameNumber;
+    {
+        QML_RENDER_STAGE(m_stats, Sync, frame);
+        m_renderControl->sync();
+    }
+
+    const QRect rect = readbackRect();
+    const bool pipelined = m_pipelined && m_asyncReadback;
 
     // NOTE: normally, in a gui application, the main thread would not be blocked whilst rendering takes place
-    // The main thread, here,  must wait untill the rendering is done because we only care about the final rendered result
+    // The main thread, here,  must wait untill the rendering is done because we only care about the final rendered result,
+    // unless rendering is pipelined: the frame is read back asynchronously, so the main thread only has to wait for
+    // the sync and can advance and polish the next frame while this one renders, like Qt's threaded render loop does
+    if (pipelined) {
+        m_cond.wakeOne();
+        lock->unlock();
+    }
+
+    {
+        QML_RENDER_STAGE(m_stats, Render, frame);
+        m_renderControl->render();
+    }
+    {
+        QML_RENDER_STAGE(m_stats, Flush, frame);
+        m_context->functions()->glFlush();
+    }
+
+    if (m_asyncReadback) {
+        startReadback(frame, rect);
+    } else {
+        {
+            QML_RENDER_STAGE(m_stats, Readback, frame);
+            readPixels(rect);
+        }
+        const uchar *pixels = reinterpret_cast<const uchar *>(m_readbackBuffer.constData());
+        QML_RENDER_STAGE(m_stats, Convert, frame);
+        if (m_hasTarget) {
+            writeTarget(pixels, m_fbo->size());
+            m_image = QImage();
+        } else {
+            storeImage(pixels, rect);
+        }
+        m_readRect = rect;
+    }
+
+    if (!pipelined) {
+        m_cond.wakeOne();
+        lock->unlock();
+    }
+}
+
+void QmlCoreRenderer::setTarget(uchar *data, int bytesPerLine)
+{
+    m_hasTarget = data != nullptr;
+    m_targetPixelFormat = -1;
+    m_targetPlanes[0] = { data, bytesPerLine };
+}
+
+void QmlCoreRenderer::setTarget(QmlPixelConverter::PixelFormat format, const QmlPixelConverter::Plane *planes)
+{
+    m_hasTarget = true;
+    m_targetPixelFormat = format;
+    for (int i = 0; i < QmlPixelConverter::planeCount(format); ++i) {
+        m_targetPlanes[i] = planes[i];
+    }
+}
+
+QRect QmlCoreRenderer::readbackRect() const
+{
+    const QRect full(QPoint(0, 0), m_fbo->size());
+    // Patching needs the previous frame in the same size and a byte aligned format,
+    // pending asynchronous readbacks will leave one behind
+    const Readback &pending = m_readbacks[(m_nextReadback + m_readbacks.size() - 1) % m_readbacks.size()];
+    const bool previousFrame = (m_image.size() == full.size() && m_image.format() == m_format)
+        || (pending.frame >= 0 && pending.size == full.size());
+    if (m_dirtyRect.isEmpty() || m_hasTarget || !previousFrame || QImage::toPixelFormat(m_format).bitsPerPixel() % 8 != 0) {
+        return full;
+    }
+    // In FBO pixels already, the device pixel ratio is applied by the content item
+    const QRect rect = m_dirtyRect & full;
+    return rect.isEmpty() ? full : rect;
+}
+
+void QmlCoreRenderer::readPixels(const QRect &rect)
+{
+    m_readbackBuffer.resize(rect.width() * rect.height() * 4);
+
+    // GL rows count from the bottom
+    m_fbo->bind();
+    m_context->functions()->glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    m_context->functions()->glReadPixels(rect.x(), m_fbo->height() - rect.y() - rect.height(), rect.width(), rect.height(),
+                                         GL_RGBA, GL_UNSIGNED_BYTE, m_readbackBuffer.data());
+    m_fbo->release();
+}
 
-    m_renderControl->render();
-    m_context->functions()->glFlush();
+void QmlCoreRenderer::storeImage(const uchar *pixels, const QRect &rect)
+{
+    if (rect.size() == m_fbo->size()) {
+        m_image = convertedImage(pixels, rect.size());
+        return;
+    }
+    Q_ASSERT(m_image.size() == m_fbo->size() && m_image.format() == m_format);
+    // Copies the image if it is still shared with an earlier frame
+    const QImage patch = convertedImage(pixels, rect.size());
+    const int bytesPerPixel = m_image.depth() / 8;
+    for (int y = 0; y < patch.height(); ++y) {
+        memcpy(m_image.scanLine(rect.y() + y) + rect.x() * bytesPerPixel, patch.constScanLine(y), size_t(patch.width() * bytesPerPixel));
+    }
+}
+
+QImage QmlCoreRenderer::convertedImage(const uchar *pixels, const QSize &size) const
+{
+    // Flip and convert in one pass, GL rows are bottom-up
+    QmlPixelConverter::PixelFormat format;
+    if (QmlPixelConverter::fromImageFormat(m_format, &format)) {
+        QImage image(size, m_format);
+        const QmlPixelConverter::Plane plane = { image.bits(), image.bytesPerLine() };
+        QmlPixelConverter::convert(pixels, size.width() * 4, size, true, format, &plane);
+        return image;
+    }
+    return QImage(pixels, size.width(), size.height(), size.width() * 4, QImage::Format_RGBA8888_Premultiplied)
+        .mirrored().convertToFormat(m_format);
+}
+
+void QmlCoreRenderer::writeTarget(const uchar *pixels, const QSize &size)
+{
+    QmlPixelConverter::PixelFormat format;
+    if (m_targetPixelFormat >= 0) {
+        format = QmlPixelConverter::PixelFormat(m_targetPixelFormat);
+    } else if (!QmlPixelConverter::fromImageFormat(m_format, &format)) {
+        const QImage image = convertedImage(pixels, size);
+        const int rowBytes = qMin(image.bytesPerLine(), m_targetPlanes[0].bytesPerLine);
+        for (int y = 0; y < image.height(); ++y) {
+            memcpy(m_targetPlanes[0].data + y * m_targetPlanes[0].bytesPerLine, image.constScanLine(y), size_t(rowBytes));
+        }
+        return;
+    }
+    QmlPixelConverter::convert(pixels, size.width() * 4, size, true, format, m_targetPlanes);
+}
+
+void QmlCoreRenderer::startReadback(int frame, const QRect &rect)
+{
+    Readback &readback = m_readbacks[m_nextReadback];
+    if (readback.frame >= 0) {
+        finishReadback(readback);
+    }
+
+    const QSize size = m_fbo->size();
+    const int bytes = size.width() * size.height() * 4;
+    if (!readback.buffer) {
+        readback.buffer = new QOpenGLBuffer(QOpenGLBuffer::PixelPackBuffer);
+        readback.buffer->setUsagePattern(QOpenGLBuffer::StreamRead);
+        readback.buffer->create();
+    }
+    readback.buffer->bind();
+    if (readback.size != size) {
+        readback.buffer->allocate(bytes);
+        readback.size = size;
+    }
+
+    // Only queues the transfer, glReadPixels returns without waiting for the GPU
+    QML_RENDER_STAGE(m_stats, Readback, frame);
+    m_fbo->bind();
+    m_context->functions()->glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    m_context->functions()->glReadPixels(rect.x(), size.height() - rect.y() - rect.height(), rect.width(), rect.height(),
+                                         GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    m_fbo->release();
+    readback.buffer->release();
+    readback.rect = rect;
+    readback.frame = frame;
+
+    m_nextReadback = (m_nextReadback + 1) % m_readbacks.size();
+    // The oldest pending transfer had a whole frame of rendering to complete
+    Readback &oldest = m_readbacks[m_nextReadback];
+    if (oldest.frame >= 0) {
+        finishReadback(oldest);
+    }
+}
+
+void QmlCoreRenderer::finishReadback(Readback &readback)
+{
+    const int bytes = readback.rect.width() * readback.rect.height() * 4;
+    readback.buffer->bind();
+    void *pixels;
+    {
+        // Mapping waits for the transfer if the GPU is not done yet
+        QML_RENDER_STAGE(m_stats, Readback, readback.frame);
+        pixels = readback.buffer->mapRange(0, bytes, QOpenGLBuffer::RangeRead);
+        if (!pixels) {
+            pixels = readback.buffer->map(QOpenGLBuffer::ReadOnly);
+        }
+    }
 
-    m_image = m_fbo->toImage();
-    m_image.convertTo(m_format);
+    if (pixels) {
+        // Readbacks finish in order, so m_image holds the frame before this one
+        {
+            QML_RENDER_STAGE(m_stats, Convert, readback.frame);
+            storeImage(static_cast<const uchar *>(pixels), readback.rect);
+        }
+        QMutexLocker lock(&m_completedMutex);
+        m_completedFrames.enqueue(CompletedFrame{readback.frame, m_image, readback.rect});
+        readback.buffer->unmap();
+    } else {
+        qWarning("!!!!! ERROR : Failed to map pixel buffer of frame %d", readback.frame);
+    }
+    readback.buffer->release();
+    readback.frame = -1;
+}
 
+void QmlCoreRenderer::flushReadbacks()
+{
+    if (m_context->makeCurrent(m_offscreenSurface)) {
+        for (int i = 0; i < m_readbacks.size(); ++i) {
+            Readback &readback = m_readbacks[(m_nextReadback + i) % m_readbacks.size()];
+            if (readback.frame >= 0) {
+                finishReadback(readback);
+            }
+        }
+    }
     m_cond.wakeOne();
-    lock->unlock();
+}
+
+bool QmlCoreRenderer::takeCompletedFrame(int *frame, QImage *image, QRect *readRect)
+{
+    QMutexLocker lock(&m_completedMutex);
+    if (m_completedFrames.isEmpty()) {
+        return false;
+    }
+    const CompletedFrame completed = m_completedFrames.dequeue();
+    *frame = completed.frame;
+    *image = completed.image;
+    if (readRect) {
+        *readRect = completed.readRect;
+    }
+    return true;
 }
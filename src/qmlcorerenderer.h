@@ -23,6 +23,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define QMLCORERENDERER_H
 
 #include <qmlanimationdriver.h>
+#include "qmlpixelconverter.h"
+#include "qmlrenderstats.h"
 #include <QObject>
 #include <QSize>
 #include <QImage>
@@ -43,6 +45,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QEventLoop>
 #include <QMutex>
 #include <QWaitCondition>
+#include <QOpenGLBuffer>
+#include <QQueue>
+#include <QVector>
+#include <QPair>
 #include <QtCore/QAnimationDriver>
 
 static const QEvent::Type INIT = QEvent::Type(QEvent::User + 1);
@@ -50,6 +56,7 @@ static const QEvent::Type RENDER = QEvent::Type(QEvent::User + 2);
 static const QEvent::Type RESIZE = QEvent::Type(QEvent::User + 3);
 static const QEvent::Type STOP = QEvent::Type(QEvent::User + 4);
 static const QEvent::Type UPDATE = QEvent::Type(QEvent::User + 5);
+static const QEvent::Type FLUSH = QEvent::Type(QEvent::User + 6);
 
 class QmlCoreRenderer : public QObject
 {
@@ -61,6 +68,7 @@ public:
     void requestRender() { QCoreApplication::postEvent(this, new QEvent(RENDER)); }
     void requestResize() { QCoreApplication::postEvent(this, new QEvent(RESIZE)); }
     void requestStop() { QCoreApplication::postEvent(this, new QEvent(STOP)); }
+    void requestFlush() { QCoreApplication::postEvent(this, new QEvent(FLUSH)); }
     void setContext(QOpenGLContext *context) { m_context = context; }
     void setSurface(QOffscreenSurface *surface) { m_offscreenSurface = surface; }
     void setQuickWindow(QQuickWindow *window) { m_quickWindow = window; }
@@ -70,6 +78,33 @@ public:
     void setDPR(qreal value) { m_dpr = value; }
     void setFPS(int value) { m_fps = value;}
     void setFormat( QImage::Format f) { m_format = f; }
+    // Stage timings of the render thread are recorded here, if enabled
+    void setStats(QmlRenderStats *stats) { m_stats = stats; }
+    /*
+     * With asynchronous readback the frame is read into a ring of pixel buffer
+     * objects and only mapped once the next frame has been rendered, so frames
+     * arrive in the completion queue one frame late. Pending readbacks are
+     * pushed out by requestFlush().
+     */
+    void setAsyncReadback(bool enabled) { m_asyncReadback = enabled; }
+    void setFrameNumber(int frame) { m_frameNumber = frame; }
+    // With asynchronous readback, lets the main thread go as soon as the scene is synced
+    void setPipelined(bool enabled) { m_pipelined = enabled; }
+    // When set, synchronous renders are written into this memory instead of m_image
+    void setTarget(uchar *data, int bytesPerLine);
+    void setTarget(QmlPixelConverter::PixelFormat format, const QmlPixelConverter::Plane *planes);
+    void clearTarget() { m_hasTarget = false; }
+    bool hasTarget() const { return m_hasTarget; }
+    /*
+     * The part of the scene (in FBO pixels) that changed since the frame
+     * rendered before. Only that part is read back and patched into the previous
+     * image, an empty rect reads back everything. Writes into a target are
+     * always complete.
+     */
+    void setDirtyRect(const QRect &rect) { m_dirtyRect = rect; }
+    // Pixels of the last synchronously rendered image that were read back
+    QRect readRect() const { return m_readRect; }
+    bool takeCompletedFrame(int *frame, QImage *image, QRect *readRect = nullptr);
     void checkifAnimDriverRunning() { m_animationDriver->isRunning()? qDebug() << " 1 driver running": qDebug() << "2  driver is NOT running :)"; }
     QWaitCondition *cond() { return &m_cond; }
     QMutex *mutex() { return &m_mutex; }
@@ -79,9 +114,30 @@ private:
     bool event(QEvent *e) override;
     void cleanup();
     void init();
+    void resize();
     void ensureFbo();
     void render(QMutexLocker *lock);
 
+    struct Readback {
+        QOpenGLBuffer *buffer;
+        QSize size;
+        QRect rect;
+        int frame;
+    };
+    struct CompletedFrame {
+        int frame;
+        QImage image;
+        QRect readRect;
+    };
+    QRect readbackRect() const;
+    void startReadback(int frame, const QRect &rect);
+    void finishReadback(Readback &readback);
+    void flushReadbacks();
+    void readPixels(const QRect &rect);
+    void storeImage(const uchar *pixels, const QRect &rect);
+    QImage convertedImage(const uchar *pixels, const QSize &size) const;
+    void writeTarget(const uchar *pixels, const QSize &size);
+
     QWaitCondition m_cond;
     QMutex m_mutex;
     QOpenGLContext* m_context;
@@ -96,6 +152,20 @@ private:
     QMutex m_quitMutex;
     int m_fps;
     QImage m_image;
+    bool m_asyncReadback;
+    bool m_pipelined;
+    int m_frameNumber;
+    QVector<Readback> m_readbacks;
+    int m_nextReadback;
+    QMutex m_completedMutex;
+    QQueue<CompletedFrame> m_completedFrames;
+    bool m_hasTarget;
+    int m_targetPixelFormat;
+    QmlPixelConverter::Plane m_targetPlanes[3];
+    QmlRenderStats *m_stats;
+    QByteArray m_readbackBuffer;
+    QRect m_dirtyRect;
+    QRect m_readRect;
 };
 
 #endif // CORERENDERER_H
@@ -0,0 +1,145 @@
+/*
+Copyright (C) 2019  Akhil K Gangadharan <helloimakhil@gmail.com>
+This file is part of Kdenlive. See www.kdenlive.org.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of
+the License or (at your option) version 3 or any later version
+accepted by the membership of KDE e.V. (or its successor approved
+by the membership of KDE e.V.), which shall act as a proxy
+defined in Section 14 of version 3 of the license.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "qmldirtytracker.h"
+
+#include <QMetaProperty>
+
+QmlDirtyTracker::QmlDirtyTracker(QObject *parent)
+    : QObject(parent)
+    , m_root(nullptr)
+    , m_full(true)
+    , m_itemChangedIndex(staticMetaObject.indexOfSlot("itemChanged()"))
+{
+}
+
+void QmlDirtyTracker::setRoot(QQuickItem *root)
+{
+    for (auto it = m_bounds.constBegin(); it != m_bounds.constEnd(); ++it) {
+        disconnect(it.key(), nullptr, this, nullptr);
+    }
+    m_bounds.clear();
+    m_dirty.clear();
+    m_removed = QRectF();
+    m_full = true;
+    m_root = root;
+    if (m_root) {
+        track(m_root);
+    }
+}
+
+QRect QmlDirtyTracker::takeDirtyRect(const QSize &sceneSize)
+{
+    const QRect scene(QPoint(0, 0), sceneSize);
+    if (!m_root) {
+        return scene;
+    }
+    if (m_full) {
+        m_full = false;
+        m_dirty.clear();
+        m_removed = QRectF();
+        updateBounds(m_root);
+        return scene;
+    }
+
+    QRectF dirty = m_removed;
+    for (QQuickItem *item : qAsConst(m_dirty)) {
+        auto it = m_bounds.constFind(item);
+        if (it == m_bounds.constEnd()) {
+            continue;
+        }
+        dirty |= it.value();
+        const QRectF bounds = updateBounds(item);
+        dirty |= bounds;
+        // Ancestors have to cover where their children went
+        for (QQuickItem *parent = item->parentItem(); parent && m_bounds.contains(parent); parent = parent->parentItem()) {
+            m_bounds[parent] |= bounds;
+        }
+    }
+    m_dirty.clear();
+    m_removed = QRectF();
+
+    if (dirty.isEmpty()) {
+        return QRect();
+    }
+    // Antialiased edges reach into the next pixel
+    return dirty.toAlignedRect().adjusted(-1, -1, 1, 1) & scene;
+}
+
+void QmlDirtyTracker::itemChanged()
+{
+    m_dirty.insert(static_cast<QQuickItem *>(sender()));
+}
+
+void QmlDirtyTracker::itemChildrenChanged()
+{
+    QQuickItem *item = static_cast<QQuickItem *>(sender());
+    for (QQuickItem *child : item->childItems()) {
+        track(child);
+    }
+    m_dirty.insert(item);
+}
+
+void QmlDirtyTracker::itemDestroyed(QObject *object)
+{
+    // Only the address is left, the item is gone
+    QQuickItem *item = static_cast<QQuickItem *>(object);
+    m_removed |= m_bounds.take(item);
+    m_dirty.remove(item);
+}
+
+void QmlDirtyTracker::track(QQuickItem *item)
+{
+    if (m_bounds.contains(item)) {
+        return;
+    }
+    m_bounds.insert(item, QRectF());
+    m_dirty.insert(item);
+
+    const QMetaObject *metaObject = item->metaObject();
+    for (int i = 0; i < metaObject->propertyCount(); ++i) {
+        const QMetaProperty property = metaObject->property(i);
+        if (property.hasNotifySignal()) {
+            QMetaObject::connect(item, property.notifySignalIndex(), this, m_itemChangedIndex, Qt::UniqueConnection);
+        }
+    }
+    connect(item, &QQuickItem::childrenChanged, this, &QmlDirtyTracker::itemChildrenChanged, Qt::UniqueConnection);
+    connect(item, &QObject::destroyed, this, &QmlDirtyTracker::itemDestroyed, Qt::UniqueConnection);
+
+    for (QQuickItem *child : item->childItems()) {
+        track(child);
+    }
+}
+
+QRectF QmlDirtyTracker::updateBounds(QQuickItem *item)
+{
+    QRectF bounds;
+    if (item->isVisible()) {
+        if (item->opacity() > 0.0) {
+            bounds = item->mapRectToScene(item->boundingRect());
+        }
+        for (QQuickItem *child : item->childItems()) {
+            bounds |= updateBounds(child);
+        }
+    }
+    m_bounds[item] = bounds;
+    return bounds;
+}
@@ -0,0 +1,76 @@
+/*
+Copyright (C) 2019  Akhil K Gangadharan <helloimakhil@gmail.com>
+This file is part of Kdenlive. See www.kdenlive.org.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of
+the License or (at your option) version 3 or any later version
+accepted by the membership of KDE e.V. (or its successor approved
+by the membership of KDE e.V.), which shall act as a proxy
+defined in Section 14 of version 3 of the license.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef QMLDIRTYTRACKER_H
+#define QMLDIRTYTRACKER_H
+
+#include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QRect>
+#include <QQuickItem>
+
+/*
+ * Follows the notify signals of every item of a scene and works out which part
+ * of the scene changed between two frames: the union of the old and new bounds
+ * of every item (with its children) that changed, plus the old bounds of items
+ * that were destroyed. Bounds only ever grow between full updates, so the
+ * result may be larger than needed.
+ *
+ * Only item properties with notify signals are followed. Transform objects,
+ * grouped properties such as border, gradient stops, layers and shaders drawing
+ * outside the item's bounds and QQuickPaintedItem::update() go unnoticed, so the
+ * result is a hint for templates animating plain item properties, not a
+ * guarantee.
+*/
+class QmlDirtyTracker : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit QmlDirtyTracker(QObject *parent = nullptr);
+
+    // Tracks root and all items below it, the next dirty rect is the whole scene
+    void setRoot(QQuickItem *root);
+    void invalidate() { m_full = true; }
+    // Whether any tracked item changed since the last dirty rect was taken
+    bool hasChanges() const { return m_full || !m_dirty.isEmpty() || !m_removed.isEmpty(); }
+    // Changed area since the last call in scene coordinates, clipped to sceneSize
+    QRect takeDirtyRect(const QSize &sceneSize);
+
+private slots:
+    void itemChanged();
+    void itemChildrenChanged();
+    void itemDestroyed(QObject *object);
+
+private:
+    void track(QQuickItem *item);
+    QRectF updateBounds(QQuickItem *item);
+
+    QQuickItem *m_root;
+    QHash<QQuickItem *, QRectF> m_bounds;
+    QSet<QQuickItem *> m_dirty;
+    QRectF m_removed;
+    bool m_full;
+    int m_itemChangedIndex;
+};
+
+#endif // QMLDIRTYTRACKER_H
@@ -0,0 +1,281 @@
+/*
+Copyright (C) 2019  Akhil K Gangadharan <helloimakhil@gmail.com>
+This file is part of Kdenlive. See www.kdenlive.org.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of
+the License or (at your option) version 3 or any later version
+accepted by the membership of KDE e.V. (or its successor approved
+by the membership of KDE e.V.), which shall act as a proxy
+defined in Section 14 of version 3 of the license.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "qmlframecache.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+bool QmlFrameCache::Key::operator==(const Key &other) const
+{
+    return frame == other.frame && size == other.size && format == other.format
+        && devicePixelRatio == other.devicePixelRatio
+        && fpsNumerator == other.fpsNumerator && fpsDenominator == other.fpsDenominator
+        && source == other.source && properties == other.properties;
+}
+
+uint qHash(const QmlFrameCache::Key &key, uint seed)
+{
+    uint h = qHash(key.source, seed) ^ qHash(key.properties, seed);
+    h ^= qHash(key.size.width(), seed) + 0x9e3779b9 + (h << 6) + (h >> 2);
+    h ^= qHash(key.size.height(), seed) + 0x9e3779b9 + (h << 6) + (h >> 2);
+    h ^= qHash(key.devicePixelRatio, seed) + 0x9e3779b9 + (h << 6) + (h >> 2);
+    h ^= qHash(int(key.format), seed) + 0x9e3779b9 + (h << 6) + (h >> 2);
+    h ^= qHash(key.fpsNumerator, seed) + 0x9e3779b9 + (h << 6) + (h >> 2);
+    h ^= qHash(key.fpsDenominator, seed) + 0x9e3779b9 + (h << 6) + (h >> 2);
+    h ^= qHash(key.frame, seed) + 0x9e3779b9 + (h << 6) + (h >> 2);
+    return h;
+}
+
+QmlFrameCache::QmlFrameCache(qint64 memoryLimit)
+    : m_memoryLimit(memoryLimit)
+    , m_memoryUsed(0)
+    , m_hits(0)
+    , m_diskHits(0)
+    , m_misses(0)
+{
+}
+
+QByteArray QmlFrameCache::sourceKey(const QUrl &url)
+{
+    QMutexLocker lock(&m_mutex);
+    QDateTime lastModified;
+    if (url.isLocalFile()) {
+        lastModified = QFileInfo(url.toLocalFile()).lastModified();
+    }
+    auto it = m_sources.constFind(url);
+    if (it != m_sources.constEnd() && it->lastModified == lastModified) {
+        return it->key;
+    }
+
+    // Only the top level file is hashed, files it imports are identified by the url
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(url.toEncoded());
+    if (url.isLocalFile()) {
+        QFile file(url.toLocalFile());
+        if (file.open(QIODevice::ReadOnly)) {
+            hash.addData(&file);
+        }
+    }
+    const QByteArray key = hash.result();
+    m_sources.insert(url, Source{lastModified, key});
+    return key;
+}
+
+bool QmlFrameCache::find(const Key &key, QImage *image)
+{
+    QMutexLocker lock(&m_mutex);
+    auto it = m_frames.constFind(key);
+    if (it != m_frames.constEnd()) {
+        m_recentlyUsed.removeOne(key);
+        m_recentlyUsed.append(key);
+        *image = it.value();
+        m_hits++;
+        return true;
+    }
+    // Evicted, but another thread is still writing it out
+    auto spilling = m_spilling.constFind(key);
+    if (spilling != m_spilling.constEnd()) {
+        *image = spilling.value();
+        m_hits++;
+        return true;
+    }
+    if (m_diskDirectory.isEmpty()) {
+        m_misses++;
+        return false;
+    }
+
+    // Decoding happens without the lock, other renderers go on meanwhile
+    const QString path = diskPath(key);
+    lock.unlock();
+    QImage stored(path);
+    if (stored.isNull()) {
+        lock.relock();
+        m_misses++;
+        return false;
+    }
+    *image = stored.convertToFormat(key.format);
+    image->setDevicePixelRatio(key.devicePixelRatio);
+    lock.relock();
+    m_diskHits++;
+    lock.unlock();
+    insert(key, *image);
+    return true;
+}
+
+void QmlFrameCache::insert(const Key &key, const QImage &image)
+{
+    QMutexLocker lock(&m_mutex);
+    const qint64 cost = image.sizeInBytes();
+    if (image.isNull() || cost > m_memoryLimit) {
+        return;
+    }
+    auto it = m_frames.find(key);
+    if (it != m_frames.end()) {
+        m_memoryUsed -= it->sizeInBytes();
+        m_recentlyUsed.removeOne(key);
+    }
+    // The image is implicitly shared, callers keep their copy at no cost
+    m_frames.insert(key, image);
+    m_recentlyUsed.append(key);
+    m_memoryUsed += cost;
+    const QList<Key> evicted = evict();
+    lock.unlock();
+    spill(evicted);
+}
+
+void QmlFrameCache::clear()
+{
+    QMutexLocker lock(&m_mutex);
+    m_frames.clear();
+    m_recentlyUsed.clear();
+    m_memoryUsed = 0;
+    // Only files this cache wrote, the directory may hold anything else
+    for (const QString &path : qAsConst(m_diskFiles)) {
+        QFile::remove(path);
+    }
+    m_diskFiles.clear();
+}
+
+void QmlFrameCache::setMemoryLimit(qint64 bytes)
+{
+    QMutexLocker lock(&m_mutex);
+    m_memoryLimit = bytes;
+    const QList<Key> evicted = evict();
+    lock.unlock();
+    spill(evicted);
+}
+
+qint64 QmlFrameCache::memoryLimit() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_memoryLimit;
+}
+
+qint64 QmlFrameCache::memoryUsed() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_memoryUsed;
+}
+
+int QmlFrameCache::count() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_frames.count();
+}
+
+void QmlFrameCache::setDiskDirectory(const QString &path)
+{
+    QMutexLocker lock(&m_mutex);
+    if (!path.isEmpty() && !QDir().mkpath(path)) {
+        qWarning() << "Cannot create frame cache directory" << path;
+        m_diskDirectory.clear();
+        return;
+    }
+    m_diskDirectory = path;
+}
+
+QString QmlFrameCache::diskDirectory() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_diskDirectory;
+}
+
+int QmlFrameCache::hits() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_hits;
+}
+
+int QmlFrameCache::diskHits() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_diskHits;
+}
+
+int QmlFrameCache::misses() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_misses;
+}
+
+void QmlFrameCache::resetStatistics()
+{
+    QMutexLocker lock(&m_mutex);
+    m_hits = 0;
+    m_diskHits = 0;
+    m_misses = 0;
+}
+
+QList<QmlFrameCache::Key> QmlFrameCache::evict()
+{
+    QList<Key> evicted;
+    while (m_memoryUsed > m_memoryLimit && !m_recentlyUsed.isEmpty()) {
+        const Key key = m_recentlyUsed.takeFirst();
+        const QImage image = m_frames.take(key);
+        m_memoryUsed -= image.sizeInBytes();
+        if (!m_diskDirectory.isEmpty()) {
+            m_spilling.insert(key, image);
+            evicted.append(key);
+        }
+    }
+    return evicted;
+}
+
+void QmlFrameCache::spill(const QList<Key> &keys)
+{
+    // Encoding happens without the lock, the frames stay findable in m_spilling until written
+    for (const Key &key : keys) {
+        QMutexLocker lock(&m_mutex);
+        const QImage image = m_spilling.value(key);
+        const QString path = diskPath(key);
+        const bool write = !m_diskDirectory.isEmpty() && !QFileInfo::exists(path);
+        lock.unlock();
+
+        // Written to a temporary file first, readers never see half a PNG
+        bool written = false;
+        if (write) {
+            QSaveFile file(path);
+            written = file.open(QIODevice::WriteOnly) && image.save(&file, "PNG") && file.commit();
+        }
+
+        lock.relock();
+        m_spilling.remove(key);
+        if (written) {
+            m_diskFiles.insert(path);
+        }
+    }
+}
+
+QString QmlFrameCache::diskPath(const Key &key) const
+{
+    QByteArray bytes;
+    QDataStream stream(&bytes, QIODevice::WriteOnly);
+    stream << key.source << key.properties << key.size << key.devicePixelRatio
+           << int(key.format) << key.fpsNumerator << key.fpsDenominator << key.frame;
+    const QByteArray name = QCryptographicHash::hash(bytes, QCryptographicHash::Sha1).toHex();
+    return m_diskDirectory + QLatin1Char('/') + QString::fromLatin1(name) + QStringLiteral(".png");
+}
@@ -0,0 +1,110 @@
+/*
+Copyright (C) 2019  Akhil K Gangadharan <helloimakhil@gmail.com>
+This file is part of Kdenlive. See www.kdenlive.org.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of
+the License or (at your option) version 3 or any later version
+accepted by the membership of KDE e.V. (or its successor approved
+by the membership of KDE e.V.), which shall act as a proxy
+defined in Section 14 of version 3 of the license.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef QMLFRAMECACHE_H
+#define QMLFRAMECACHE_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QHash>
+#include <QImage>
+#include <QList>
+#include <QMutex>
+#include <QSet>
+#include <QSize>
+#include <QString>
+#include <QUrl>
+
+/*
+ * Rendered frames kept in memory for repeated requests of the same frame, e.g.
+ * looping previews or scrubbing back and forth. Bounded by a memory budget in
+ * bytes, the least recently used frame is dropped first. With a disk directory
+ * set, dropped frames are written there as PNG and read back on a later miss.
+ *
+ * One cache can be shared by several renderers, also across threads.
+*/
+class QmlFrameCache
+{
+public:
+    struct Key {
+        QByteArray source;      // sourceKey() of the QML file
+        QByteArray properties;  // serialized property overrides, empty if none
+        QSize size;
+        qreal devicePixelRatio;
+        QImage::Format format;
+        int fpsNumerator;
+        int fpsDenominator;
+        int frame;
+
+        bool operator==(const Key &other) const;
+    };
+
+    explicit QmlFrameCache(qint64 memoryLimit = 256 * 1024 * 1024);
+
+    // Identifies url by its contents, so an edited file never hits old frames
+    QByteArray sourceKey(const QUrl &url);
+
+    bool find(const Key &key, QImage *image);
+    void insert(const Key &key, const QImage &image);
+    void clear();
+
+    void setMemoryLimit(qint64 bytes);
+    qint64 memoryLimit() const;
+    qint64 memoryUsed() const;
+    int count() const;
+    // Empty (the default) disables the disk tier
+    void setDiskDirectory(const QString &path);
+    QString diskDirectory() const;
+
+    int hits() const;
+    int diskHits() const;
+    int misses() const;
+    void resetStatistics();
+
+private:
+    struct Source {
+        QDateTime lastModified;
+        QByteArray key;
+    };
+
+    QList<Key> evict();
+    void spill(const QList<Key> &keys);
+    QString diskPath(const Key &key) const;
+
+    mutable QMutex m_mutex;
+    QHash<Key, QImage> m_frames;
+    QList<Key> m_recentlyUsed;
+    // Evicted frames being written to disk
+    QHash<Key, QImage> m_spilling;
+    // Files written to the disk directory, the only ones clear() removes
+    QSet<QString> m_diskFiles;
+    QHash<QUrl, Source> m_sources;
+    QString m_diskDirectory;
+    qint64 m_memoryLimit;
+    qint64 m_memoryUsed;
+    int m_hits;
+    int m_diskHits;
+    int m_misses;
+};
+
+uint qHash(const QmlFrameCache::Key &key, uint seed = 0);
+
+#endif // QMLFRAMECACHE_H
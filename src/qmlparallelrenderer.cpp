@@ -0,0 +1,152 @@
+/*
+Copyright (C) 2019  Akhil K Gangadharan <helloimakhil@gmail.com>
+This file is part of Kdenlive. See www.kdenlive.org.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of
+the License or (at your option) version 3 or any later version
+accepted by the membership of KDE e.V. (or its successor approved
+by the membership of KDE e.V.), which shall act as a proxy
+defined in Section 14 of version 3 of the license.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "qmlparallelrenderer.h"
+#include <QThread>
+
+QmlParallelRenderer::QmlParallelRenderer(QString qmlFileUrlString, int fps, int duration, int jobs, QObject *parent)
+    : QObject(parent)
+    , m_qmlFileUrl(qmlFileUrlString)
+    , m_fps(fps)
+    , m_duration(duration)
+    , m_fpsNumerator(fps)
+    , m_fpsDenominator(1)
+    , m_dpr(1.0)
+    , m_jobs(qMax(1, jobs))
+    , m_maxPendingFrames(64)
+    , m_nextFrame(0)
+{
+}
+
+QmlParallelRenderer::~QmlParallelRenderer()
+{
+}
+
+void QmlParallelRenderer::setFrameRate(int numerator, int denominator)
+{
+    m_fpsNumerator = numerator;
+    m_fpsDenominator = denominator;
+}
+
+int QmlParallelRenderer::renderRange(int width, int height, QImage::Format format, int first, int last, const QmlRenderer::FrameSink &sink)
+{
+    last = qMin(last, int(qint64(m_duration) * m_fpsNumerator / m_fpsDenominator) - 1);
+    if (first < 0 || first > last) {
+        return 0;
+    }
+
+    const int frames = last - first + 1;
+    const int jobs = qMin(m_jobs, frames);
+    m_ranges.clear();
+    m_pendingFrames.clear();
+    m_nextFrame = first;
+    for (int i = 0, start = first; i < jobs; ++i) {
+        const int length = frames / jobs + (i < frames % jobs ? 1 : 0);
+        m_ranges.append(Range{start, start + length - 1, false});
+        start += length;
+    }
+
+    // Windows and surfaces are created on the calling thread, each worker only
+    // renders with the renderer handed over to it and hands it back when done
+    QThread *home = QThread::currentThread();
+    QVector<QThread *> workers;
+    QVector<QmlRenderer *> renderers;
+    for (int i = 0; i < jobs; ++i) {
+        QmlRenderer *renderer = new QmlRenderer(m_qmlFileUrl, m_fps, m_duration);
+        if (m_fpsDenominator != 1) {
+            renderer->setFrameRate(m_fpsNumerator, m_fpsDenominator);
+        }
+        renderer->setDevicePixelRatio(m_dpr);
+
+        const Range range = m_ranges.at(i);
+        QThread *worker = QThread::create([=]() {
+            renderer->renderRange(width, height, format, range.first, range.last, [this](int frame, const QImage &image) {
+                queueFrame(frame, image);
+            });
+            renderer->release();
+            renderer->moveRendererToThread(home);
+            finishRange(i);
+        });
+        renderer->moveRendererToThread(worker);
+        renderers.append(renderer);
+        workers.append(worker);
+        worker->start();
+    }
+
+    int delivered = 0;
+    QMutexLocker lock(&m_mutex);
+    while (m_nextFrame <= last) {
+        if (!m_pendingFrames.contains(m_nextFrame)) {
+            if (rangeFinished(m_nextFrame)) {
+                qWarning("QmlParallelRenderer: frame %d was not rendered", m_nextFrame);
+                m_nextFrame++;
+                m_frameTaken.wakeAll();
+            } else {
+                m_frameQueued.wait(&m_mutex);
+            }
+            continue;
+        }
+
+        const QImage image = m_pendingFrames.take(m_nextFrame);
+        lock.unlock();
+        sink(m_nextFrame, image);
+        delivered++;
+        lock.relock();
+        m_nextFrame++;
+        m_frameTaken.wakeAll();
+    }
+    lock.unlock();
+
+    for (QThread *worker : qAsConst(workers)) {
+        worker->wait();
+        delete worker;
+    }
+    qDeleteAll(renderers);
+    return delivered;
+}
+
+void QmlParallelRenderer::queueFrame(int frame, const QImage &image)
+{
+    QMutexLocker lock(&m_mutex);
+    // The frame due next is never held back, so the worker owning it always progresses
+    while (frame != m_nextFrame && m_pendingFrames.size() >= m_maxPendingFrames) {
+        m_frameTaken.wait(&m_mutex);
+    }
+    m_pendingFrames.insert(frame, image);
+    m_frameQueued.wakeAll();
+}
+
+void QmlParallelRenderer::finishRange(int index)
+{
+    QMutexLocker lock(&m_mutex);
+    m_ranges[index].finished = true;
+    m_frameQueued.wakeAll();
+}
+
+bool QmlParallelRenderer::rangeFinished(int frame) const
+{
+    for (const Range &range : m_ranges) {
+        if (frame >= range.first && frame <= range.last) {
+            return range.finished;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,87 @@
+/*
+Copyright (C) 2019  Akhil K Gangadharan <helloimakhil@gmail.com>
+This file is part of Kdenlive. See www.kdenlive.org.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of
+the License or (at your option) version 3 or any later version
+accepted by the membership of KDE e.V. (or its successor approved
+by the membership of KDE e.V.), which shall act as a proxy
+defined in Section 14 of version 3 of the license.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef QMLPARALLELRENDERER_H
+#define QMLPARALLELRENDERER_H
+
+#include "qmlrenderer.h"
+
+#include <QObject>
+#include <QMap>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QVector>
+
+/*
+ * Renders a frame range of a QML file with several independent renderers, each
+ * with its own thread, OpenGL context, window and engine. Since animation time
+ * only depends on the frame number, every renderer is given one contiguous part
+ * of the range, seeks to its start and renders it. Frames are handed to the sink
+ * on the calling thread, in frame order.
+ *
+ * The renderers are created and destroyed on the calling thread, which has to be
+ * the GUI thread, and are moved to their worker thread for rendering only.
+*/
+class QmlParallelRenderer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit QmlParallelRenderer(QString qmlFileUrlString, int fps, int duration, int jobs = QThread::idealThreadCount(), QObject *parent = nullptr);
+    ~QmlParallelRenderer() override;
+
+    int renderRange(int width, int height, QImage::Format format, int first, int last, const QmlRenderer::FrameSink &sink);
+
+    void setFrameRate(int numerator, int denominator);
+    void setDevicePixelRatio(qreal ratio) { m_dpr = ratio; }
+    int jobs() const { return m_jobs; }
+    // Upper bound of frames that finished ahead of their turn and wait to be handed out
+    void setMaxPendingFrames(int frames) { m_maxPendingFrames = qMax(1, frames); }
+
+private:
+    struct Range {
+        int first;
+        int last;
+        bool finished;
+    };
+
+    void queueFrame(int frame, const QImage &image);
+    void finishRange(int index);
+    bool rangeFinished(int frame) const;
+
+    QString m_qmlFileUrl;
+    int m_fps;
+    int m_duration;
+    int m_fpsNumerator;
+    int m_fpsDenominator;
+    qreal m_dpr;
+    int m_jobs;
+    int m_maxPendingFrames;
+
+    QMutex m_mutex;
+    QWaitCondition m_frameQueued;
+    QWaitCondition m_frameTaken;
+    QMap<int, QImage> m_pendingFrames;
+    QVector<Range> m_ranges;
+    int m_nextFrame;
+};
+
+#endif // QMLPARALLELRENDERER_H
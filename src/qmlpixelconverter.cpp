@@ -0,0 +1,614 @@
+/*
+Copyright (C) 2019  Akhil K Gangadharan <helloimakhil@gmail.com>
+This file is part of Kdenlive. See www.kdenlive.org.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of
+the License or (at your option) version 3 or any later version
+accepted by the membership of KDE e.V. (or its successor approved
+by the membership of KDE e.V.), which shall act as a proxy
+defined in Section 14 of version 3 of the license.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "qmlpixelconverter.h"
+#include <QAtomicInt>
+#include <QVector>
+#include <cmath>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define QMLPIXELCONVERTER_X86
+#include <immintrin.h>
+#define QML_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+/*
+ * All kernels read premultiplied RGBA8888. The SIMD variants are written to do
+ * exactly the same arithmetic as the scalar ones (same float operations for
+ * unpremultiplying, same two step rounding when averaging chroma), so every
+ * variant gives bit identical output.
+ *
+ * YUV uses BT.709 limited range coefficients in 8.8 fixed point:
+ *   Y = ((  47 R + 157 G +  16 B + 128) >> 8) + 16
+ *   U =  ( -26 R -  86 G + 112 B + 32896) >> 8
+ *   V =  ( 112 R - 102 G -  10 B + 32896) >> 8
+ * which keeps every intermediate in the unsigned 16 bit range.
+ *
+ * Scaling averages the source pixels a destination pixel covers. Rows are summed
+ * with integer weights adding up to 256 into 16 bit accumulators, then columns
+ * with float weights, rounded to nearest even as the SIMD conversion does.
+*/
+
+namespace {
+
+typedef void (*ShuffleFunc)(const uchar *src, uchar *dst, int width, bool swapRB, bool opaque);
+typedef void (*UnpremultiplyFunc)(const uchar *src, uchar *dst, int width, bool swapRB);
+typedef void (*LumaFunc)(const uchar *src, uchar *dst, int width);
+typedef void (*ChromaFunc)(const uchar *row0, const uchar *row1, uchar *dstU, uchar *dstV, int width);
+typedef void (*AccumulateFunc)(const uchar *src, quint16 *acc, int count, int weight);
+typedef void (*ReduceFunc)(const quint16 *acc, uchar *dst, int width, const int *spans, const float *weights);
+
+struct Kernels {
+    ShuffleFunc shuffle;
+    UnpremultiplyFunc unpremultiply;
+    LumaFunc luma;
+    ChromaFunc chroma;
+    AccumulateFunc accumulate;
+    ReduceFunc reduce;
+};
+
+// Scalar
+
+void shuffleScalar(const uchar *src, uchar *dst, int width, bool swapRB, bool opaque)
+{
+    const int r = swapRB ? 2 : 0;
+    const int b = swapRB ? 0 : 2;
+    for (int x = 0; x < width; ++x, src += 4, dst += 4) {
+        dst[r] = src[0];
+        dst[1] = src[1];
+        dst[b] = src[2];
+        dst[3] = opaque ? 0xff : src[3];
+    }
+}
+
+inline uchar unpremultiplyChannel(uchar c, float factor)
+{
+    const int v = int(float(c) * factor + 0.5f);
+    return uchar(v > 255 ? 255 : v);
+}
+
+void unpremultiplyScalar(const uchar *src, uchar *dst, int width, bool swapRB)
+{
+    const int r = swapRB ? 2 : 0;
+    const int b = swapRB ? 0 : 2;
+    for (int x = 0; x < width; ++x, src += 4, dst += 4) {
+        const uchar a = src[3];
+        const float factor = a ? 255.0f / float(a) : 0.0f;
+        dst[r] = unpremultiplyChannel(src[0], factor);
+        dst[1] = unpremultiplyChannel(src[1], factor);
+        dst[b] = unpremultiplyChannel(src[2], factor);
+        dst[3] = a;
+    }
+}
+
+void lumaScalar(const uchar *src, uchar *dst, int width)
+{
+    for (int x = 0; x < width; ++x, src += 4) {
+        dst[x] = uchar(((47 * src[0] + 157 * src[1] + 16 * src[2] + 128) >> 8) + 16);
+    }
+}
+
+void chromaScalar(const uchar *row0, const uchar *row1, uchar *dstU, uchar *dstV, int width)
+{
+    for (int x = 0; x < width; x += 2, row0 += 8, row1 += 8) {
+        // An odd last column is paired with itself
+        const int next = x + 1 < width ? 4 : 0;
+        int rgb[3];
+        for (int c = 0; c < 3; ++c) {
+            const int left = (row0[c] + row1[c] + 1) >> 1;
+            const int right = (row0[next + c] + row1[next + c] + 1) >> 1;
+            rgb[c] = (left + right + 1) >> 1;
+        }
+        *dstU++ = uchar((-26 * rgb[0] - 86 * rgb[1] + 112 * rgb[2] + 32896) >> 8);
+        *dstV++ = uchar((112 * rgb[0] - 102 * rgb[1] - 10 * rgb[2] + 32896) >> 8);
+    }
+}
+
+void accumulateScalar(const uchar *src, quint16 *acc, int count, int weight)
+{
+    for (int i = 0; i < count; ++i) {
+        acc[i] = quint16(acc[i] + src[i] * weight);
+    }
+}
+
+// spans holds first source pixel and pixel count of every destination pixel
+void reduceScalar(const quint16 *acc, uchar *dst, int width, const int *spans, const float *weights)
+{
+    for (int x = 0; x < width; ++x, dst += 4) {
+        const quint16 *p = acc + 4 * spans[2 * x];
+        float sum[4] = { 0, 0, 0, 0 };
+        for (int i = 0; i < spans[2 * x + 1]; ++i, p += 4, ++weights) {
+            for (int c = 0; c < 4; ++c) {
+                sum[c] += float(p[c]) * *weights;
+            }
+        }
+        for (int c = 0; c < 4; ++c) {
+            dst[c] = uchar(qBound(0L, std::lrint(sum[c]), 255L));
+        }
+    }
+}
+
+#ifdef QMLPIXELCONVERTER_X86
+
+// SSE2
+
+QML_TARGET("sse2")
+void shuffleSse2(const uchar *src, uchar *dst, int width, bool swapRB, bool opaque)
+{
+    const __m128i greenAlpha = _mm_set1_epi32(int(0xff00ff00));
+    const __m128i low = _mm_set1_epi32(0xff);
+    const __m128i alpha = _mm_set1_epi32(opaque ? int(0xff000000) : 0);
+    int x = 0;
+    for (; x + 4 <= width; x += 4, src += 16, dst += 16) {
+        __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+        if (swapRB) {
+            p = _mm_or_si128(_mm_and_si128(p, greenAlpha),
+                             _mm_or_si128(_mm_slli_epi32(_mm_and_si128(p, low), 16),
+                                          _mm_and_si128(_mm_srli_epi32(p, 16), low)));
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), _mm_or_si128(p, alpha));
+    }
+    shuffleScalar(src, dst, width - x, swapRB, opaque);
+}
+
+QML_TARGET("sse2")
+inline __m128i unpremultiplyPixelSse2(__m128 p, bool swapRB)
+{
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 rgbMask = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+    const __m128 alphaOne = _mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f);
+    if (swapRB) {
+        p = _mm_shuffle_ps(p, p, _MM_SHUFFLE(3, 0, 1, 2));
+    }
+    const __m128 a = _mm_shuffle_ps(p, p, _MM_SHUFFLE(3, 3, 3, 3));
+    __m128 factor = _mm_andnot_ps(_mm_cmpeq_ps(a, zero), _mm_div_ps(_mm_set1_ps(255.0f), a));
+    factor = _mm_or_ps(_mm_and_ps(factor, rgbMask), alphaOne);
+    return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(p, factor), _mm_set1_ps(0.5f)));
+}
+
+QML_TARGET("sse2")
+void unpremultiplySse2(const uchar *src, uchar *dst, int width, bool swapRB)
+{
+    const __m128i zero = _mm_setzero_si128();
+    int x = 0;
+    for (; x + 4 <= width; x += 4, src += 16, dst += 16) {
+        const __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+        const __m128i p01 = _mm_unpacklo_epi8(p, zero);
+        const __m128i p23 = _mm_unpackhi_epi8(p, zero);
+        const __m128i q0 = unpremultiplyPixelSse2(_mm_cvtepi32_ps(_mm_unpacklo_epi16(p01, zero)), swapRB);
+        const __m128i q1 = unpremultiplyPixelSse2(_mm_cvtepi32_ps(_mm_unpackhi_epi16(p01, zero)), swapRB);
+        const __m128i q2 = unpremultiplyPixelSse2(_mm_cvtepi32_ps(_mm_unpacklo_epi16(p23, zero)), swapRB);
+        const __m128i q3 = unpremultiplyPixelSse2(_mm_cvtepi32_ps(_mm_unpackhi_epi16(p23, zero)), swapRB);
+        const __m128i out = _mm_packus_epi16(_mm_packs_epi32(q0, q1), _mm_packs_epi32(q2, q3));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), out);
+    }
+    unpremultiplyScalar(src, dst, width - x, swapRB);
+}
+
+// Splits 4 RGBA pixels per register into 16 bit R, G and B of 8 pixels
+QML_TARGET("sse2")
+inline void deinterleaveSse2(__m128i p0, __m128i p1, __m128i *r, __m128i *g, __m128i *b)
+{
+    const __m128i low = _mm_set1_epi32(0xff);
+    *r = _mm_packs_epi32(_mm_and_si128(p0, low), _mm_and_si128(p1, low));
+    *g = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(p0, 8), low), _mm_and_si128(_mm_srli_epi32(p1, 8), low));
+    *b = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(p0, 16), low), _mm_and_si128(_mm_srli_epi32(p1, 16), low));
+}
+
+QML_TARGET("sse2")
+inline __m128i weightedSumSse2(__m128i r, __m128i g, __m128i b, short wr, short wg, short wb, short bias)
+{
+    __m128i sum = _mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(wr)), _mm_mullo_epi16(g, _mm_set1_epi16(wg)));
+    sum = _mm_add_epi16(sum, _mm_mullo_epi16(b, _mm_set1_epi16(wb)));
+    return _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(bias)), 8);
+}
+
+QML_TARGET("sse2")
+void lumaSse2(const uchar *src, uchar *dst, int width)
+{
+    int x = 0;
+    for (; x + 8 <= width; x += 8, src += 32) {
+        __m128i r, g, b;
+        deinterleaveSse2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src)),
+                         _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 16)), &r, &g, &b);
+        const __m128i y = _mm_add_epi16(weightedSumSse2(r, g, b, 47, 157, 16, 128), _mm_set1_epi16(16));
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(dst + x), _mm_packus_epi16(y, y));
+    }
+    lumaScalar(src, dst + x, width - x);
+}
+
+// Averages pairs of neighbouring pixels, returning 2 pixels in the low half
+QML_TARGET("sse2")
+inline __m128i pairAverageSse2(__m128i p)
+{
+    const __m128i avg = _mm_avg_epu8(p, _mm_shuffle_epi32(p, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_shuffle_epi32(avg, _MM_SHUFFLE(3, 1, 2, 0));
+}
+
+QML_TARGET("sse2")
+void chromaSse2(const uchar *row0, const uchar *row1, uchar *dstU, uchar *dstV, int width)
+{
+    int x = 0;
+    for (; x + 8 <= width; x += 8, row0 += 32, row1 += 32, dstU += 4, dstV += 4) {
+        const __m128i v0 = _mm_avg_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(row0)),
+                                        _mm_loadu_si128(reinterpret_cast<const __m128i *>(row1)));
+        const __m128i v1 = _mm_avg_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(row0 + 16)),
+                                        _mm_loadu_si128(reinterpret_cast<const __m128i *>(row1 + 16)));
+        const __m128i p = _mm_unpacklo_epi64(pairAverageSse2(v0), pairAverageSse2(v1));
+        __m128i r, g, b;
+        deinterleaveSse2(p, p, &r, &g, &b);
+        const __m128i u = weightedSumSse2(r, g, b, -26, -86, 112, short(32896));
+        const __m128i v = weightedSumSse2(r, g, b, 112, -102, -10, short(32896));
+        const int packedU = _mm_cvtsi128_si32(_mm_packus_epi16(u, u));
+        const int packedV = _mm_cvtsi128_si32(_mm_packus_epi16(v, v));
+        memcpy(dstU, &packedU, 4);
+        memcpy(dstV, &packedV, 4);
+    }
+    chromaScalar(row0, row1, dstU, dstV, width - x);
+}
+
+QML_TARGET("sse2")
+void accumulateSse2(const uchar *src, quint16 *acc, int count, int weight)
+{
+    const __m128i w = _mm_set1_epi16(short(weight));
+    const __m128i zero = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        __m128i *a = reinterpret_cast<__m128i *>(acc + i);
+        _mm_storeu_si128(a, _mm_add_epi16(_mm_loadu_si128(a), _mm_mullo_epi16(_mm_unpacklo_epi8(p, zero), w)));
+        _mm_storeu_si128(a + 1, _mm_add_epi16(_mm_loadu_si128(a + 1), _mm_mullo_epi16(_mm_unpackhi_epi8(p, zero), w)));
+    }
+    accumulateScalar(src + i, acc + i, count - i, weight);
+}
+
+QML_TARGET("sse2")
+void reduceSse2(const quint16 *acc, uchar *dst, int width, const int *spans, const float *weights)
+{
+    const __m128i zero = _mm_setzero_si128();
+    for (int x = 0; x < width; ++x, dst += 4) {
+        const quint16 *p = acc + 4 * spans[2 * x];
+        __m128 sum = _mm_setzero_ps();
+        for (int i = 0; i < spans[2 * x + 1]; ++i, p += 4, ++weights) {
+            const __m128i channels = _mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(p)), zero);
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_cvtepi32_ps(channels), _mm_set1_ps(*weights)));
+        }
+        const __m128i rounded = _mm_cvtps_epi32(sum);
+        const int pixel = _mm_cvtsi128_si32(_mm_packus_epi16(_mm_packs_epi32(rounded, rounded), zero));
+        memcpy(dst, &pixel, 4);
+    }
+}
+
+// AVX2
+
+QML_TARGET("avx2")
+void shuffleAvx2(const uchar *src, uchar *dst, int width, bool swapRB, bool opaque)
+{
+    const __m256i order = swapRB ? _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+                                                     2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15)
+                                 : _mm256_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+                                                    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    const __m256i alpha = _mm256_set1_epi32(opaque ? int(0xff000000) : 0);
+    int x = 0;
+    for (; x + 8 <= width; x += 8, src += 32, dst += 32) {
+        const __m256i p = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst), _mm256_or_si256(_mm256_shuffle_epi8(p, order), alpha));
+    }
+    shuffleScalar(src, dst, width - x, swapRB, opaque);
+}
+
+// Unpremultiplies the 2 pixels in the low 8 bytes of p
+QML_TARGET("avx2")
+inline __m256i unpremultiplyPairAvx2(__m128i p, bool swapRB)
+{
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 rgbMask = _mm256_castsi256_ps(_mm256_setr_epi32(-1, -1, -1, 0, -1, -1, -1, 0));
+    const __m256 alphaOne = _mm256_setr_ps(0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+    __m256 f = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(p));
+    if (swapRB) {
+        f = _mm256_shuffle_ps(f, f, _MM_SHUFFLE(3, 0, 1, 2));
+    }
+    const __m256 a = _mm256_shuffle_ps(f, f, _MM_SHUFFLE(3, 3, 3, 3));
+    __m256 factor = _mm256_andnot_ps(_mm256_cmp_ps(a, zero, _CMP_EQ_OQ), _mm256_div_ps(_mm256_set1_ps(255.0f), a));
+    factor = _mm256_or_ps(_mm256_and_ps(factor, rgbMask), alphaOne);
+    return _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(f, factor), _mm256_set1_ps(0.5f)));
+}
+
+QML_TARGET("avx2")
+void unpremultiplyAvx2(const uchar *src, uchar *dst, int width, bool swapRB)
+{
+    // packs/packus work per 128 bit lane, this puts the pixels back in order
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    int x = 0;
+    for (; x + 8 <= width; x += 8, src += 32, dst += 32) {
+        const __m256i q01 = unpremultiplyPairAvx2(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(src)), swapRB);
+        const __m256i q23 = unpremultiplyPairAvx2(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(src + 8)), swapRB);
+        const __m256i q45 = unpremultiplyPairAvx2(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(src + 16)), swapRB);
+        const __m256i q67 = unpremultiplyPairAvx2(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(src + 24)), swapRB);
+        const __m256i out = _mm256_packus_epi16(_mm256_packs_epi32(q01, q23), _mm256_packs_epi32(q45, q67));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst), _mm256_permutevar8x32_epi32(out, order));
+    }
+    unpremultiplyScalar(src, dst, width - x, swapRB);
+}
+
+QML_TARGET("avx2")
+void lumaAvx2(const uchar *src, uchar *dst, int width)
+{
+    const __m256i low = _mm256_set1_epi32(0xff);
+    int x = 0;
+    for (; x + 16 <= width; x += 16, src += 64) {
+        const __m256i p0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src));
+        const __m256i p1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + 32));
+        const __m256i r = _mm256_packs_epi32(_mm256_and_si256(p0, low), _mm256_and_si256(p1, low));
+        const __m256i g = _mm256_packs_epi32(_mm256_and_si256(_mm256_srli_epi32(p0, 8), low),
+                                             _mm256_and_si256(_mm256_srli_epi32(p1, 8), low));
+        const __m256i b = _mm256_packs_epi32(_mm256_and_si256(_mm256_srli_epi32(p0, 16), low),
+                                             _mm256_and_si256(_mm256_srli_epi32(p1, 16), low));
+        __m256i y = _mm256_add_epi16(_mm256_mullo_epi16(r, _mm256_set1_epi16(47)), _mm256_mullo_epi16(g, _mm256_set1_epi16(157)));
+        y = _mm256_add_epi16(y, _mm256_mullo_epi16(b, _mm256_set1_epi16(16)));
+        y = _mm256_add_epi16(_mm256_srli_epi16(_mm256_add_epi16(y, _mm256_set1_epi16(128)), 8), _mm256_set1_epi16(16));
+        // Undo the lane interleaving of packs, then of packus
+        y = _mm256_permute4x64_epi64(y, _MM_SHUFFLE(3, 1, 2, 0));
+        const __m256i bytes = _mm256_permute4x64_epi64(_mm256_packus_epi16(y, _mm256_setzero_si256()), _MM_SHUFFLE(3, 1, 2, 0));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), _mm256_castsi256_si128(bytes));
+    }
+    lumaScalar(src, dst + x, width - x);
+}
+
+QML_TARGET("avx2")
+void accumulateAvx2(const uchar *src, quint16 *acc, int count, int weight)
+{
+    const __m256i w = _mm256_set1_epi16(short(weight));
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m256i p = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i)));
+        __m256i *a = reinterpret_cast<__m256i *>(acc + i);
+        _mm256_storeu_si256(a, _mm256_add_epi16(_mm256_loadu_si256(a), _mm256_mullo_epi16(p, w)));
+    }
+    accumulateScalar(src + i, acc + i, count - i, weight);
+}
+
+#endif // QMLPIXELCONVERTER_X86
+
+// Part of destination pixel i covering source pixel j, in 1 / dstLength source pixels
+int overlap(int srcLength, int dstLength, int i, int j)
+{
+    const qint64 begin = qMax(qint64(i) * srcLength, qint64(j) * dstLength);
+    const qint64 end = qMin(qint64(i + 1) * srcLength, qint64(j + 1) * dstLength);
+    return int(end - begin);
+}
+
+int firstCovered(int srcLength, int dstLength, int i)
+{
+    return int(qint64(i) * srcLength / dstLength);
+}
+
+int lastCovered(int srcLength, int dstLength, int i)
+{
+    return int((qint64(i + 1) * srcLength - 1) / dstLength);
+}
+
+const Kernels &kernelsFor(QmlPixelConverter::Isa isa)
+{
+    static const Kernels scalar = { shuffleScalar, unpremultiplyScalar, lumaScalar, chromaScalar,
+                                    accumulateScalar, reduceScalar };
+#ifdef QMLPIXELCONVERTER_X86
+    static const Kernels sse2 = { shuffleSse2, unpremultiplySse2, lumaSse2, chromaSse2,
+                                  accumulateSse2, reduceSse2 };
+    // Chroma works on half as many output samples and a reduced pixel is a
+    // single SSE register, the SSE2 kernels are kept for them
+    static const Kernels avx2 = { shuffleAvx2, unpremultiplyAvx2, lumaAvx2, chromaSse2,
+                                  accumulateAvx2, reduceSse2 };
+    switch (isa) {
+    case QmlPixelConverter::AVX2:
+        return avx2;
+    case QmlPixelConverter::SSE2:
+        return sse2;
+    default:
+        break;
+    }
+#else
+    Q_UNUSED(isa);
+#endif
+    return scalar;
+}
+
+QAtomicInt s_isa(-1);
+
+} // namespace
+
+QmlPixelConverter::Isa QmlPixelConverter::bestIsa()
+{
+#ifdef QMLPIXELCONVERTER_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return AVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return SSE2;
+    }
+#endif
+    return Scalar;
+}
+
+QmlPixelConverter::Isa QmlPixelConverter::isa()
+{
+    int current = s_isa.loadAcquire();
+    if (current < 0) {
+        current = bestIsa();
+        s_isa.storeRelease(current);
+    }
+    return Isa(current);
+}
+
+void QmlPixelConverter::setIsa(Isa isa)
+{
+    s_isa.storeRelease(qMin(isa, bestIsa()));
+}
+
+bool QmlPixelConverter::fromImageFormat(QImage::Format imageFormat, PixelFormat *format)
+{
+    switch (imageFormat) {
+    case QImage::Format_RGBA8888:
+        *format = RGBA8888;
+        return true;
+    case QImage::Format_RGBA8888_Premultiplied:
+        *format = RGBA8888_Premultiplied;
+        return true;
+    case QImage::Format_RGBX8888:
+        *format = RGBX8888;
+        return true;
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    // 32 bit ARGB values are stored as B, G, R, A bytes on little endian
+    case QImage::Format_ARGB32:
+        *format = BGRA8888;
+        return true;
+    case QImage::Format_ARGB32_Premultiplied:
+        *format = BGRA8888_Premultiplied;
+        return true;
+    case QImage::Format_RGB32:
+        *format = BGRX8888;
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+int QmlPixelConverter::planeCount(PixelFormat format)
+{
+    return format == YUV420P || format == YUV422P ? 3 : 1;
+}
+
+QSize QmlPixelConverter::planeSize(PixelFormat format, int plane, const QSize &size)
+{
+    if (plane == 0 || planeCount(format) == 1) {
+        return size;
+    }
+    const int chromaWidth = (size.width() + 1) / 2;
+    return QSize(chromaWidth, format == YUV420P ? (size.height() + 1) / 2 : size.height());
+}
+
+void QmlPixelConverter::convert(const uchar *src, int srcBytesPerLine, const QSize &size, bool flip,
+                                PixelFormat format, const Plane *planes)
+{
+    const Kernels &k = kernelsFor(isa());
+    const int width = size.width();
+    const int height = size.height();
+    const qptrdiff srcStride = flip ? -qptrdiff(srcBytesPerLine) : qptrdiff(srcBytesPerLine);
+    const uchar *firstRow = flip ? src + qptrdiff(height - 1) * srcBytesPerLine : src;
+    auto row = [&](int y) { return firstRow + y * srcStride; };
+    auto out = [&](int plane, int y) { return planes[plane].data + qptrdiff(y) * planes[plane].bytesPerLine; };
+
+    switch (format) {
+    case RGBA8888_Premultiplied:
+        for (int y = 0; y < height; ++y) {
+            memcpy(out(0, y), row(y), size_t(width) * 4);
+        }
+        break;
+    case RGBX8888:
+    case BGRA8888_Premultiplied:
+    case BGRX8888: {
+        const bool swapRB = format != RGBX8888;
+        const bool opaque = format != BGRA8888_Premultiplied;
+        for (int y = 0; y < height; ++y) {
+            k.shuffle(row(y), out(0, y), width, swapRB, opaque);
+        }
+        break;
+    }
+    case RGBA8888:
+    case BGRA8888:
+        for (int y = 0; y < height; ++y) {
+            k.unpremultiply(row(y), out(0, y), width, format == BGRA8888);
+        }
+        break;
+    case YUV420P:
+    case YUV422P: {
+        for (int y = 0; y < height; ++y) {
+            k.luma(row(y), out(0, y), width);
+        }
+        const bool subsampleRows = format == YUV420P;
+        const int chromaHeight = planeSize(format, 1, size).height();
+        for (int y = 0; y < chromaHeight; ++y) {
+            const int top = subsampleRows ? 2 * y : y;
+            const int bottom = subsampleRows ? qMin(top + 1, height - 1) : top;
+            k.chroma(row(top), row(bottom), out(1, y), out(2, y), width);
+        }
+        break;
+    }
+    }
+}
+
+void QmlPixelConverter::scale(const uchar *src, int srcBytesPerLine, const QSize &size,
+                              uchar *dst, int dstBytesPerLine, const QSize &dstSize)
+{
+    const Kernels &k = kernelsFor(isa());
+    const int srcWidth = size.width();
+    const int srcHeight = size.height();
+    const int dstWidth = dstSize.width();
+    const int dstHeight = dstSize.height();
+    if (size == dstSize) {
+        for (int y = 0; y < dstHeight; ++y) {
+            memcpy(dst + qptrdiff(y) * dstBytesPerLine, src + qptrdiff(y) * srcBytesPerLine, size_t(dstWidth) * 4);
+        }
+        return;
+    }
+
+    // Columns are the same for every row
+    QVector<int> spans(2 * dstWidth);
+    QVector<float> columnWeights;
+    columnWeights.reserve(dstWidth * (srcWidth / dstWidth + 2));
+    for (int x = 0; x < dstWidth; ++x) {
+        const int first = firstCovered(srcWidth, dstWidth, x);
+        const int last = lastCovered(srcWidth, dstWidth, x);
+        spans[2 * x] = first;
+        spans[2 * x + 1] = last - first + 1;
+        for (int j = first; j <= last; ++j) {
+            columnWeights.append(overlap(srcWidth, dstWidth, x, j) / (256.0f * srcWidth));
+        }
+    }
+
+    QVector<quint16> acc(srcWidth * 4);
+    QVector<int> rowWeights;
+    for (int y = 0; y < dstHeight; ++y) {
+        const int first = firstCovered(srcHeight, dstHeight, y);
+        const int last = lastCovered(srcHeight, dstHeight, y);
+        // Rounding the running total to 1/256 keeps the weights adding up to exactly 256
+        rowWeights.resize(last - first + 1);
+        qint64 covered = 0;
+        int previous = 0;
+        for (int j = first; j <= last; ++j) {
+            covered += overlap(srcHeight, dstHeight, y, j);
+            const int rounded = int((covered * 256 + srcHeight / 2) / srcHeight);
+            rowWeights[j - first] = rounded - previous;
+            previous = rounded;
+        }
+
+        acc.fill(0);
+        for (int j = first; j <= last; ++j) {
+            if (rowWeights.at(j - first) > 0) {
+                k.accumulate(src + qptrdiff(j) * srcBytesPerLine, acc.data(), srcWidth * 4, rowWeights.at(j - first));
+            }
+        }
+        k.reduce(acc.constData(), dst + qptrdiff(y) * dstBytesPerLine, dstWidth, spans.constData(), columnWeights.constData());
+    }
+}
@@ -0,0 +1,87 @@
+/*
+Copyright (C) 2019  Akhil K Gangadharan <helloimakhil@gmail.com>
+This file is part of Kdenlive. See www.kdenlive.org.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of
+the License or (at your option) version 3 or any later version
+accepted by the membership of KDE e.V. (or its successor approved
+by the membership of KDE e.V.), which shall act as a proxy
+defined in Section 14 of version 3 of the license.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef QMLPIXELCONVERTER_H
+#define QMLPIXELCONVERTER_H
+
+#include <QImage>
+#include <QSize>
+
+/*
+ * Converts frames read back from OpenGL (premultiplied RGBA8888, rows possibly
+ * bottom-up) into the pixel formats video pipelines want, flipping, swizzling,
+ * unpremultiplying and writing the output in a single pass.
+ *
+ * The kernels exist in scalar, SSE2 and AVX2 variants which produce identical
+ * output, the best one supported by the CPU is picked at runtime.
+*/
+class QmlPixelConverter
+{
+public:
+    enum PixelFormat {
+        RGBA8888,
+        RGBA8888_Premultiplied,
+        RGBX8888,
+        BGRA8888,
+        BGRA8888_Premultiplied,
+        BGRX8888,
+        YUV420P,    // BT.709, limited range, planes Y U V
+        YUV422P
+    };
+
+    enum Isa {
+        Scalar,
+        SSE2,
+        AVX2
+    };
+
+    struct Plane {
+        uchar *data;
+        int bytesPerLine;
+    };
+
+    static Isa bestIsa();
+    static Isa isa();
+    // Restricts the kernels to isa (capped to bestIsa()), mainly for benchmarks
+    static void setIsa(Isa isa);
+
+    static bool fromImageFormat(QImage::Format imageFormat, PixelFormat *format);
+    static int planeCount(PixelFormat format);
+    static QSize planeSize(PixelFormat format, int plane, const QSize &size);
+
+    /*
+     * Converts size pixels of premultiplied RGBA8888 at src into format, writing
+     * planeCount(format) planes. With flip set the source rows are bottom-up, as
+     * returned by glReadPixels.
+     */
+    static void convert(const uchar *src, int srcBytesPerLine, const QSize &size, bool flip,
+                        PixelFormat format, const Plane *planes);
+    /*
+     * Scales size pixels of 32 bit src to dstSize by averaging the source pixels
+     * every destination pixel covers, for a proxy or thumbnail of a rendered
+     * frame. Channels are averaged independently, so the pixels must be
+     * premultiplied or opaque.
+     */
+    static void scale(const uchar *src, int srcBytesPerLine, const QSize &size,
+                      uchar *dst, int dstBytesPerLine, const QSize &dstSize);
+};
+
+#endif // QMLPIXELCONVERTER_H
@@ -20,6 +20,25 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include "qmlrenderer.h"
 #include <QEvent>
+#include <QDataStream>
+#include <private/qabstractanimation_p.h>
+#include <private/qabstractanimationjob_p.h>
+
+// Averaging needs 32 bit pixels, premultiplied so transparent pixels do not bleed colour
+static QImage::Format scalingFormat(QImage::Format format)
+{
+    switch (format) {
+    case QImage::Format_ARGB32_Premultiplied:
+    case QImage::Format_RGB32:
+    case QImage::Format_RGBA8888_Premultiplied:
+    case QImage::Format_RGBX8888:
+        return format;
+    case QImage::Format_RGBA8888:
+        return QImage::Format_RGBA8888_Premultiplied;
+    default:
+        return QImage::Format_ARGB32_Premultiplied;
+    }
+}
 
 /*
  * The QmlRenderer class renders a given QML file using QQuickRenderControl
@@ -41,9 +60,22 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
  *
  * The renderer uses it's own custom QAnimationDriver class to advance QML animations
  * at a given frame rate.
+ *
+ * Only one animation driver can be installed per thread, and it drives every
+ * animation of the thread. So only one renderer per thread holds a session: a
+ * renderer starting one releases the session of the previous renderer, which
+ * loads its scene again on its next render.
 */
 
+// The renderer whose driver is installed on the current thread
+static thread_local QmlRenderer *s_activeRenderer = nullptr;
+
 QmlRenderer::QmlRenderer(QString qmlFileUrlString, int fps, int duration, QObject *parent)
+    : QmlRenderer(qmlFileUrlString, fps, duration, nullptr, parent)
+{
+}
+
+QmlRenderer::QmlRenderer(QString qmlFileUrlString, int fps, int duration, QQmlEngine *engine, QObject *parent)
     : QObject(parent)
     , m_fbo(nullptr)
     , m_animationDriver(nullptr)
@@ -53,8 +85,10 @@ QmlRenderer::QmlRenderer(QString qmlFileUrlString, int fps, int duration, QObjec
     , m_renderControl(nullptr)
     , m_rootItem(nullptr)
     , m_corerenderer(nullptr)
+    , m_dirtyTracker(nullptr)
     , m_qmlComponent(nullptr)
     , m_qmlEngine(nullptr)
+    , m_qmlContext(nullptr)
     , m_status(NotRunning)
     , m_qmlFileUrl(qmlFileUrlString)
     , m_dpr(1.0)
@@ -62,6 +96,19 @@ QmlRenderer::QmlRenderer(QString qmlFileUrlString, int fps, int duration, QObjec
     , m_fps(fps)
     , m_currentFrame(0)
     , m_framesCount(fps*duration)
+    , m_fpsNumerator(fps)
+    , m_fpsDenominator(1)
+    , m_lastRenderedFrame(-1)
+    , m_sessionMode(true)
+    , m_asyncReadback(true)
+    , m_pipelinedRendering(true)
+    , m_partialReadback(false)
+    , m_sceneDirty(true)
+    , m_renderControlInitialised(false)
+    , m_loadSource(QmlComponentCache::NotLoaded)
+    , m_staticFramesServed(0)
+    , m_frameCache(nullptr)
+    , m_outputsKey(0)
 {
     //    QCoreApplication::setAttribute(Qt::AA_DontCheckOpenGLContextThreadAffinity);
     QSurfaceFormat format;
@@ -86,10 +133,15 @@ QmlRenderer::QmlRenderer(QString qmlFileUrlString, int fps, int duration, QObjec
     m_quickWindow = new QQuickWindow(m_renderControl);
     Q_ASSERT(m_quickWindow != nullptr);
 
-    m_qmlEngine = new QQmlEngine();
-    if (!m_qmlEngine->incubationController()) {
+    // A shared engine keeps its compiled components and imports for all its renderers,
+    // its incubation controller is left to the owner
+    m_ownsEngine = engine == nullptr;
+    m_qmlEngine = m_ownsEngine ? new QQmlEngine() : engine;
+    if (m_ownsEngine && !m_qmlEngine->incubationController()) {
         m_qmlEngine->setIncubationController(m_quickWindow->incubationController());
     }
+    // Context properties of one renderer must not leak into the others of a shared engine
+    m_qmlContext = new QQmlContext(m_qmlEngine->rootContext());
 
     m_corerenderer = new QmlCoreRenderer();
     m_corerenderer->setContext(m_context);
@@ -98,6 +150,9 @@ QmlRenderer::QmlRenderer(QString qmlFileUrlString, int fps, int duration, QObjec
     m_corerenderer->setRenderControl(m_renderControl);
     m_corerenderer->setDPR(m_dpr);
     m_corerenderer->setFPS(m_fps);
+    m_corerenderer->setStats(&m_stats);
+
+    m_dirtyTracker = new QmlDirtyTracker(this);
 
     m_rendererThread = new QThread;
     m_renderControl->prepareThread(m_rendererThread);
@@ -106,6 +161,11 @@ QmlRenderer::QmlRenderer(QString qmlFileUrlString, int fps, int duration, QObjec
     m_corerenderer->moveToThread(m_rendererThread);
     m_rendererThread->start();
 
+    // Emitted on the main thread whenever an item changes, signals emitted during
+    // the sync on the render thread are queued and only cause an extra render
+    connect(m_renderControl, &QQuickRenderControl::sceneChanged, this, [this]() { m_sceneDirty = true; });
+    connect(m_renderControl, &QQuickRenderControl::renderRequested, this, [this]() { m_sceneDirty = true; });
+
     connect(
         m_quickWindow, &QQuickWindow::sceneGraphError,
         [=]( QQuickWindow::SceneGraphError error, const QString &message) {
@@ -113,7 +173,7 @@ QmlRenderer::QmlRenderer(QString qmlFileUrlString, int fps, int duration, QObjec
             }
     );
     connect(
-        m_qmlEngine, &QQmlEngine::warnings,
+        m_qmlEngine, &QQmlEngine::warnings, this,
         [=]( QList<QQmlError> warnings) {
             foreach(const QQmlError& warning, warnings) {
                 qDebug() << "!!!! QML WARNING : "  << warning << "  " ;
@@ -139,10 +199,38 @@ QmlRenderer::~QmlRenderer()
 
     m_context->doneCurrent();
 
+    if (m_animationDriver) {
+        resetDriver();
+    }
+    if (s_activeRenderer == this) {
+        s_activeRenderer = nullptr;
+    }
+
+    delete m_rootItem;
+    m_rootItem = nullptr;
+    delete m_qmlContext;
+    if (m_ownsEngine) {
+        delete m_qmlEngine;
+    }
+
     delete m_context;
     delete m_offscreenSurface;
 }
 
+void QmlRenderer::moveRendererToThread(QThread *thread)
+{
+    // The window, engine and context are not children of the renderer
+    moveToThread(thread);
+    m_quickWindow->moveToThread(thread);
+    m_qmlContext->moveToThread(thread);
+    if (m_ownsEngine) {
+        m_qmlEngine->moveToThread(thread);
+    }
+    if (m_rootItem) {
+        m_rootItem->moveToThread(thread);
+    }
+}
+
 bool QmlRenderer::eventFilter(QObject *obj, QEvent *event)
 {
     if(event->type() == QEvent::UpdateRequest)
@@ -155,53 +243,135 @@ bool QmlRenderer::eventFilter(QObject *obj, QEvent *event)
 
 void QmlRenderer::init(int width, int height, QImage::Format imageFormat)
 {
-    if (m_status == NotRunning || m_duration > 0) {
+    if (m_status == NotRunning) {
+        if (s_activeRenderer && s_activeRenderer != this) {
+            s_activeRenderer->release();
+        }
+        s_activeRenderer = this;
         initDriver();
         m_size = QSize(width, height);
         m_ImageFormat = imageFormat;
         m_corerenderer->setSize(m_size);
         m_corerenderer->setFormat(m_ImageFormat);
         loadInput();
-        m_corerenderer->requestInit();
+        warmUp();
         m_status = Initialised;
+    } else if (QSize(width, height) != m_size || imageFormat != m_ImageFormat) {
+        resize(QSize(width, height), imageFormat);
+    }
+}
+
+void QmlRenderer::resize(const QSize &size, QImage::Format imageFormat)
+{
+    // Only the geometry of the scene and the output change, the component, the
+    // item tree and the animation clock are kept
+    if (m_asyncReadback) {
+        flushReadbacks();
+    }
+    m_size = size;
+    m_ImageFormat = imageFormat;
+    applyGeometry();
+    // Snapshots hold the geometry of the items at the old size
+    m_snapshots.clear();
+    m_dirtyTracker->invalidate();
+    m_sceneDirty = true;
+    m_lastRenderedFrame = -1;
+
+    QMutexLocker lock(m_corerenderer->mutex());
+    m_corerenderer->setSize(m_size);
+    m_corerenderer->setDPR(m_dpr);
+    m_corerenderer->setFormat(m_ImageFormat);
+    m_corerenderer->requestResize();
+    m_corerenderer->cond()->wait(m_corerenderer->mutex());
+}
+
+void QmlRenderer::warmUp()
+{
+    if (!m_renderControlInitialised) {
+        m_corerenderer->requestInit();
+        m_renderControlInitialised = true;
     }
-    //TODO : W/H/Format update case?
 }
 
 void QmlRenderer::initDriver()
 {
-    /*
-    We use a corrected FPS because animations take more frames
-    than expected due to a weird behaviour of the custom QAnimation
-    Driver. For different timesteps the animations lag by a certain
-    amount of frames, values for which were investigated for different
-    values of fps's. The cause of this bug remains unknown for the time
-    being but it is probably an upstream one.
-    */
-    int correctedFps = m_fps;
-    if (m_fps < 40) {
-        correctedFps -= 1;
+    m_animationDriver = new QmlAnimationDriver(m_fpsNumerator, m_fpsDenominator);
+    m_animationDriver->install();
+    m_corerenderer->setAnimationDriver(m_animationDriver);
+}
+
+void QmlRenderer::setFrameRate(int numerator, int denominator)
+{
+    Q_ASSERT(numerator > 0 && denominator > 0);
+    m_fpsNumerator = numerator;
+    m_fpsDenominator = denominator;
+    m_fps = qRound(qreal(numerator) / denominator);
+    m_framesCount = int(qint64(m_duration) * numerator / denominator);
+    m_corerenderer->setFPS(m_fps);
+    m_snapshots.clear();
+    // Frame times changed, frames rendered so far are no longer valid
+    if (m_status == Initialised) {
+        rewind();
     }
-    else if (m_fps <= 60) {
-        correctedFps -= 2;
+}
+
+void QmlRenderer::setDevicePixelRatio(qreal ratio)
+{
+    if (ratio <= 0.0 || ratio == m_dpr) {
+        return;
     }
-    else if (m_fps <= 69) {
-        correctedFps -= 3;
+    m_dpr = ratio;
+    if (m_status == Initialised) {
+        // The framebuffer is reallocated, the current frame has to be rendered again
+        resize(m_size, m_ImageFormat);
+    } else {
+        m_corerenderer->setDPR(m_dpr);
     }
-    else if (m_fps <= 80) {
-        correctedFps -= 4;
+}
+
+void QmlRenderer::setPartialReadback(bool enabled)
+{
+    // Following every notify signal of the scene only pays off with partial readback,
+    // the first dirty rect after attaching covers the whole scene
+    m_partialReadback = enabled;
+    m_dirtyTracker->setRoot(m_partialReadback ? m_rootItem : nullptr);
+}
+
+void QmlRenderer::startPendingAnimations()
+{
+    // QML animations are started through a queued QQmlAnimationTimer::startAnimations()
+    // call, which in turn queues QUnifiedTimer::startTimers(). Both have to run before
+    // the clock moves, otherwise new animations start frames late. Only the calls to
+    // these two are delivered, queued calls of the host application wait for its own
+    // event loop.
+    if (QQmlAnimationTimer *timer = QQmlAnimationTimer::instance(false)) {
+        QCoreApplication::sendPostedEvents(timer, QEvent::MetaCall);
     }
-    else {
-        correctedFps -= 5;
+    if (QUnifiedTimer *timer = QUnifiedTimer::instance(false)) {
+        QCoreApplication::sendPostedEvents(timer, QEvent::MetaCall);
     }
+}
 
-    m_animationDriver = new QmlAnimationDriver(1000 / correctedFps);
-    m_animationDriver->install();
-    m_corerenderer->setAnimationDriver(m_animationDriver);
+void QmlRenderer::advanceTo(mlt_position frame)
+{
+    QML_RENDER_STAGE(&m_stats, Advance, frame);
+    startPendingAnimations();
+
+    if (frame == m_currentFrame + 1) {
+        m_animationDriver->advance();
+    } else {
+        m_animationDriver->seekToFrame(frame);
+    }
+    m_currentFrame = frame;
+
+    if (m_snapshots.wants(m_currentFrame)) {
+        m_snapshots.insert(QmlSceneSnapshot::capture(m_rootItem, m_currentFrame));
+    }
 }
 
 void QmlRenderer::resetDriver()
 {
+    m_corerenderer->setAnimationDriver(nullptr);
     m_animationDriver->uninstall();
     delete m_animationDriver;
     m_animationDriver = nullptr;
@@ -209,14 +379,116 @@ void QmlRenderer::resetDriver()
 
 void QmlRenderer::loadInput()
 {
-    m_qmlComponent = new QQmlComponent(m_qmlEngine, QUrl(m_qmlFileUrl), QQmlComponent::PreferSynchronous);
+    // Compiling the template is the expensive part, the compiled component is
+    // shared by every renderer using the same engine
+    QmlComponentCache *cache = QmlComponentCache::forEngine(m_qmlEngine);
+    m_qmlComponent = cache->component(m_qmlFileUrl);
+    m_loadSource = cache->lastLoadSource();
     Q_ASSERT(!m_qmlComponent->isNull() || m_qmlComponent->isReady());
+    createRootItem();
+}
+
+void QmlRenderer::createRootItem()
+{
     bool assert = loadRootObject();
     Q_ASSERT(assert);
     Q_ASSERT(!m_size.isEmpty());
+    applyGeometry();
+    m_dirtyTracker->setRoot(m_partialReadback ? m_rootItem : nullptr);
+    m_sceneDirty = true;
+}
+
+void QmlRenderer::applyGeometry()
+{
     m_rootItem->setWidth(m_size.width());
     m_rootItem->setHeight(m_size.height());
     m_quickWindow->setGeometry(0, 0, m_size.width(), m_size.height());
+    // Without a render window the scene graph projects the scene onto the framebuffer
+    // in pixels and ignores the window's device pixel ratio, so the content is scaled
+    QQuickItem *content = m_quickWindow->contentItem();
+    const qreal windowRatio = QQuickRenderControl::renderWindowFor(m_quickWindow) ? m_quickWindow->effectiveDevicePixelRatio() : 1.0;
+    content->setTransformOrigin(QQuickItem::TopLeft);
+    content->setScale(m_dpr / windowRatio);
+}
+
+void QmlRenderer::rewind()
+{
+    // Animations only run forward, so going back means starting over with a
+    // fresh item tree and a driver whose clock starts at zero
+    resetDriver();
+    m_dirtyTracker->setRoot(nullptr);
+    delete m_rootItem;
+    m_rootItem = nullptr;
+    initDriver();
+    loadInput();
+    m_currentFrame = 0;
+    m_lastRenderedFrame = -1;
+}
+
+void QmlRenderer::reset()
+{
+    if (m_status == Initialised) {
+        rewind();
+    }
+}
+
+void QmlRenderer::release()
+{
+    if (m_status != Initialised) {
+        return;
+    }
+    // Only one driver can be installed per thread, an idle renderer must not hold it
+    resetDriver();
+    if (s_activeRenderer == this) {
+        s_activeRenderer = nullptr;
+    }
+    m_dirtyTracker->setRoot(nullptr);
+    delete m_rootItem;
+    m_rootItem = nullptr;
+    m_currentFrame = 0;
+    m_lastRenderedFrame = -1;
+    m_img = QImage();
+    m_dirtyRect = QRect();
+    m_snapshots.clear();
+    m_status = NotRunning;
+}
+
+void QmlRenderer::setSource(const QString &qmlFileUrlString, int fps, int duration)
+{
+    release();
+    // Overrides belong to the previous template
+    m_properties.clear();
+    m_contextProperties.clear();
+    delete m_qmlContext;
+    m_qmlContext = new QQmlContext(m_qmlEngine->rootContext());
+    propertiesChanged();
+    m_qmlFileUrl = QUrl(qmlFileUrlString);
+    m_duration = duration;
+    m_fps = fps;
+    m_fpsNumerator = fps;
+    m_fpsDenominator = 1;
+    m_framesCount = fps * duration;
+    m_corerenderer->setFPS(m_fps);
+}
+
+void QmlRenderer::prepareSeek(mlt_position frame)
+{
+    // The scene always shows m_currentFrame, the driver is only advanced when
+    // a later frame is requested, so the current frame can be rendered again
+    const bool backwards = frame < m_currentFrame || (!m_sessionMode && m_currentFrame > 0);
+
+    if (!backwards) {
+        return;
+    }
+    // Starting from a snapshot beats starting over. A forward seek never uses one,
+    // the clock jumps straight to the requested frame anyway
+    QmlSceneSnapshot snapshot;
+    const bool useSnapshot = m_snapshots.nearest(frame, &snapshot);
+    rewind();
+    if (useSnapshot) {
+        advanceTo(mlt_position(snapshot.frame()));
+        snapshot.restore(m_rootItem);
+    }
 }
 
 bool QmlRenderer::loadRootObject()
@@ -224,13 +496,17 @@ bool QmlRenderer::loadRootObject()
     if(!checkQmlComponent()) {
         return false;
     }
-    Q_ASSERT(m_qmlComponent->create() != nullptr);
-    QObject *rootObject = m_qmlComponent->create();
-    QQmlEngine::setObjectOwnership(rootObject, QQmlEngine::CppOwnership);
-    Q_ASSERT(rootObject);
-    if(!checkQmlComponent()) {
+    // Properties go in before the bindings of the new tree are evaluated
+    QObject *rootObject = m_qmlComponent->beginCreate(m_qmlContext);
+    if (rootObject) {
+        applyProperties(rootObject);
+        m_qmlComponent->completeCreate();
+    }
+    if(!rootObject || !checkQmlComponent()) {
+        delete rootObject;
         return false;
     }
+    QQmlEngine::setObjectOwnership(rootObject, QQmlEngine::CppOwnership);
     m_rootItem = qobject_cast<QQuickItem*>(rootObject);
     if (!m_rootItem) {
         qDebug()<< "ERROR - run: Not a QQuickItem - QML file INVALID ";
@@ -241,6 +517,54 @@ bool QmlRenderer::loadRootObject()
     return true;
 }
 
+void QmlRenderer::applyProperties(QObject *rootObject)
+{
+    for (auto it = m_properties.constBegin(); it != m_properties.constEnd(); ++it) {
+        if (rootObject->metaObject()->indexOfProperty(it.key().toUtf8().constData()) < 0) {
+            qWarning() << "!!!! Root object has no property" << it.key();
+            continue;
+        }
+        rootObject->setProperty(it.key().toUtf8().constData(), it.value());
+    }
+}
+
+void QmlRenderer::setProperties(const QVariantMap &properties)
+{
+    // Keys left out keep their value on the live root item, so they are kept for
+    // trees created later and in the frame cache key too
+    for (auto it = properties.constBegin(); it != properties.constEnd(); ++it) {
+        m_properties.insert(it.key(), it.value());
+    }
+    if (m_rootItem) {
+        applyProperties(m_rootItem);
+    }
+    propertiesChanged();
+}
+
+void QmlRenderer::setContextProperties(const QVariantMap &properties)
+{
+    // A context property cannot be removed, keys left out keep their value in the
+    // context, so they stay part of the frame cache key too
+    for (auto it = properties.constBegin(); it != properties.constEnd(); ++it) {
+        m_contextProperties.insert(it.key(), it.value());
+        m_qmlContext->setContextProperty(it.key(), it.value());
+    }
+    propertiesChanged();
+}
+
+void QmlRenderer::propertiesChanged()
+{
+    // The current frame looks different now, and snapshots hold the old values
+    m_lastRenderedFrame = -1;
+    m_snapshots.clear();
+
+    m_propertiesKey.clear();
+    if (!m_properties.isEmpty() || !m_contextProperties.isEmpty()) {
+        QDataStream stream(&m_propertiesKey, QIODevice::WriteOnly);
+        stream << m_properties << m_contextProperties;
+    }
+}
+
 bool QmlRenderer::checkQmlComponent()
 {
     if (m_qmlComponent->isError()) {
@@ -262,62 +586,345 @@ QImage QmlRenderer::render(int width, int height, QImage::Format format)
 
 void QmlRenderer::renderStatic()
 {
+    if (sceneUnchanged() && !m_img.isNull()) {
+        m_staticFramesServed++;
+        m_dirtyRect = QRect();
+        return;
+    }
     polishSyncRender();
     m_img = m_corerenderer->getRenderedQImage();
+    m_dirtyRect = m_corerenderer->readRect();
 }
 
 QImage QmlRenderer::render(int width, int height, QImage::Format format, int frame)
 {
-    m_requestedFrame = frame;
-    m_currentFrame = 0;
+    // A cached frame needs no scene at all
+    QmlFrameCache::Key key;
+    QImage cached;
+    if (m_frameCache) {
+        key = cacheKey(width, height, format, frame);
+        if (m_frameCache->find(key, &cached)) {
+            return cached;
+        }
+    }
+
+    init(width, height, format);
+
+    if (frame == m_lastRenderedFrame && !m_img.isNull()) {
+        return m_img;
+    }
+    renderFrame(frame);
+    if (m_frameCache) {
+        m_frameCache->insert(key, m_img);
+    }
+    return m_img;
+}
+
+QVector<QImage> QmlRenderer::render(const QVector<QSize> &sizes, QImage::Format format, int frame)
+{
+    if (sizes.isEmpty()) {
+        return QVector<QImage>();
+    }
+    const QImage master = render(sizes.first().width(), sizes.first().height(), scalingFormat(format), frame);
+    if (master.isNull()) {
+        return QVector<QImage>();
+    }
+    return scaledOutputs(master, sizes, format);
+}
+
+int QmlRenderer::renderRange(const QVector<QSize> &sizes, QImage::Format format, int first, int last, const MultiFrameSink &sink)
+{
+    if (sizes.isEmpty()) {
+        return 0;
+    }
+    return renderRange(sizes.first().width(), sizes.first().height(), scalingFormat(format), first, last,
+                       [&](int frame, const QImage &master) {
+        sink(frame, scaledOutputs(master, sizes, format));
+    });
+}
+
+QVector<QImage> QmlRenderer::scaledOutputs(const QImage &master, const QVector<QSize> &sizes, QImage::Format format)
+{
+    // Frames of a static scene are the same image again, and so are their outputs
+    bool unchanged = master.cacheKey() == m_outputsKey && m_outputs.size() == sizes.size();
+    for (int i = 0; unchanged && i < sizes.size(); ++i) {
+        unchanged = m_outputs.at(i).format() == format && (i == 0 || m_outputs.at(i).size() == sizes.at(i));
+    }
+    if (unchanged) {
+        return m_outputs;
+    }
+
+    QVector<QImage> outputs;
+    outputs.reserve(sizes.size());
+    outputs.append(master.format() == format ? master : master.convertToFormat(format));
+    for (int i = 1; i < sizes.size(); ++i) {
+        QImage scaled(sizes.at(i), master.format());
+        QmlPixelConverter::scale(master.constBits(), master.bytesPerLine(), master.size(),
+                                 scaled.bits(), scaled.bytesPerLine(), scaled.size());
+        outputs.append(scaled.format() == format ? scaled : scaled.convertToFormat(format));
+    }
+    m_outputsKey = master.cacheKey();
+    m_outputs = outputs;
+    return outputs;
+}
+
+bool QmlRenderer::canRenderInto(int frame) const
+{
+    // The buffer holds width x height pixels, the framebuffer is larger with a pixel ratio
+    if (m_dpr != 1.0) {
+        qWarning("!!!!! ERROR : Rendering into a buffer needs a device pixel ratio of 1, not %g", m_dpr);
+        return false;
+    }
+    // Frames past the end would render the last frame into the buffer and still fail
+    return frame >= 0 && frame < m_framesCount;
+}
+
+bool QmlRenderer::render(int width, int height, QImage::Format format, int frame, uchar *buffer, int bytesPerLine)
+{
+    Q_ASSERT(buffer != nullptr);
+    if (!canRenderInto(frame)) {
+        return false;
+    }
+
+    QmlFrameCache::Key key;
+    QImage cached;
+    if (m_frameCache) {
+        key = cacheKey(width, height, format, frame);
+        if (m_frameCache->find(key, &cached)) {
+            const int rowBytes = qMin(bytesPerLine, cached.bytesPerLine());
+            for (int y = 0; y < height; ++y) {
+                memcpy(buffer + y * bytesPerLine, cached.constScanLine(y), size_t(rowBytes));
+            }
+            return true;
+        }
+    }
 
     init(width, height, format);
+
+    m_corerenderer->setTarget(buffer, bytesPerLine);
+    renderFrame(frame);
+    m_corerenderer->clearTarget();
+
+    if (m_lastRenderedFrame != frame) {
+        return false;
+    }
+    if (m_frameCache) {
+        m_frameCache->insert(key, QImage(buffer, width, height, bytesPerLine, format).copy());
+    }
+    return true;
+}
+
+bool QmlRenderer::render(int width, int height, QmlPixelConverter::PixelFormat format, int frame, const QmlPixelConverter::Plane *planes)
+{
+    Q_ASSERT(planes != nullptr);
+    if (!canRenderInto(frame)) {
+        return false;
+    }
+    init(width, height, m_status == Initialised ? m_ImageFormat : QImage::Format_ARGB32_Premultiplied);
+
+    m_corerenderer->setTarget(format, planes);
+    renderFrame(frame);
+    m_corerenderer->clearTarget();
+
+    return m_lastRenderedFrame == frame;
+}
+
+void QmlRenderer::renderFrame(mlt_position frame)
+{
+    m_requestedFrame = frame;
+    prepareSeek(m_requestedFrame);
+
     installEventFilter(this);
 
     QEventLoop loop;
     connect(this, &QmlRenderer::imageReady, &loop, &QEventLoop::quit, Qt::QueuedConnection);
     renderAnimated();
     loop.exec();
-
-    resetDriver();
-    delete m_qmlComponent;
-    delete m_rootItem;
-
-    return m_img;
 }
 
 void QmlRenderer::renderAnimated()
 {
-    polishSyncRender();
-    m_animationDriver->advance();
+    // Frames before the requested one are never rendered, the driver jumps
+    // straight to the requested frame in a single animation step
+    if (m_currentFrame < m_requestedFrame && m_currentFrame < m_framesCount - 1) {
+        advanceTo(qMin(m_requestedFrame, m_framesCount - 1));
+        QEvent *updateRequest = new QEvent(QEvent::UpdateRequest);
+        QCoreApplication::postEvent(this, updateRequest);
+        return;
+    }
 
-    if(m_currentFrame == m_requestedFrame) {
+    if (sceneUnchanged() && m_lastRenderedFrame >= 0 && !m_img.isNull()) {
+        m_staticFramesServed++;
+        m_dirtyRect = QRect();
+    } else {
+        polishSyncRender();
         m_img = m_corerenderer->getRenderedQImage();
-        removeEventFilter(this);
-        emit imageReady();
+        m_dirtyRect = m_corerenderer->readRect();
     }
+    m_lastRenderedFrame = m_currentFrame;
 
-    m_currentFrame++;
+    removeEventFilter(this);
+    emit imageReady();
+}
 
-    if (m_currentFrame < m_framesCount) {
-        QEvent *updateRequest = new QEvent(QEvent::UpdateRequest);
-        QCoreApplication::postEvent(this, updateRequest);
+int QmlRenderer::renderRange(int width, int height, QImage::Format format, int first, int last, const FrameSink &userSink)
+{
+    last = qMin(last, m_framesCount - 1);
+    if (first < 0 || first > last) {
+        return 0;
     }
 
-    else {
-        removeEventFilter(this);
-        emit imageReady();
-        return;
+    int rendered = 0;
+    FrameSink sink = userSink;
+    if (m_frameCache) {
+        // Cached frames at the start of the range are served without a scene,
+        // once rendering starts every frame goes through the cache
+        QImage cached;
+        while (first <= last && m_frameCache->find(cacheKey(width, height, format, first), &cached)) {
+            userSink(first, cached);
+            rendered++;
+            first++;
+        }
+        if (first > last) {
+            return rendered;
+        }
+        sink = [this, width, height, format, &userSink](int frame, const QImage &image) {
+            m_frameCache->insert(cacheKey(width, height, format, frame), image);
+            userSink(frame, image);
+        };
     }
+
+    init(width, height, format);
+
+    if (first == m_lastRenderedFrame && !m_img.isNull()) {
+        sink(first, m_img);
+        rendered++;
+        first++;
+        if (first > last) {
+            return rendered;
+        }
+    }
+    prepareSeek(first);
+
+    if (m_currentFrame < first) {
+        advanceTo(first);
+    }
+
+    m_corerenderer->setAsyncReadback(m_asyncReadback);
+    m_corerenderer->setPipelined(m_pipelinedRendering);
+    int inFlight = 0;
+    while (true) {
+        if (sceneUnchanged() && (inFlight > 0 || (m_lastRenderedFrame >= 0 && !m_img.isNull()))) {
+            // Same picture as the frame before, which has to be out first
+            if (inFlight > 0) {
+                flushReadbacks();
+                rendered += deliverCompletedFrames(sink);
+                inFlight = 0;
+            }
+            m_lastRenderedFrame = m_currentFrame;
+            m_dirtyRect = QRect();
+            sink(m_currentFrame, m_img);
+            rendered++;
+            m_staticFramesServed++;
+        } else if (m_asyncReadback) {
+            polishSyncRender();
+            inFlight++;
+            // Hand out whatever earlier frames have finished reading back
+            const int delivered = deliverCompletedFrames(sink);
+            inFlight -= delivered;
+            rendered += delivered;
+        } else {
+            polishSyncRender();
+            m_img = m_corerenderer->getRenderedQImage();
+            m_dirtyRect = m_corerenderer->readRect();
+            m_lastRenderedFrame = m_currentFrame;
+            sink(m_currentFrame, m_img);
+            rendered++;
+        }
+
+        if (m_currentFrame >= last) {
+            break;
+        }
+        advanceTo(m_currentFrame + 1);
+    }
+
+    if (m_asyncReadback) {
+        flushReadbacks();
+        rendered += deliverCompletedFrames(sink);
+        m_corerenderer->setAsyncReadback(false);
+        m_corerenderer->setPipelined(false);
+    }
+    return rendered;
+}
+
+QmlFrameCache::Key QmlRenderer::cacheKey(int width, int height, QImage::Format format, int frame)
+{
+    QmlFrameCache::Key key;
+    key.source = m_frameCache->sourceKey(m_qmlFileUrl);
+    key.properties = m_propertiesKey;
+    key.size = QSize(width, height);
+    key.devicePixelRatio = m_dpr;
+    key.format = format;
+    key.fpsNumerator = m_fpsNumerator;
+    key.fpsDenominator = m_fpsDenominator;
+    // Frames past the end show the last frame
+    key.frame = qBound(0, frame, m_framesCount - 1);
+    return key;
+}
+
+int QmlRenderer::deliverCompletedFrames(const FrameSink &sink)
+{
+    int delivered = 0;
+    int frame;
+    QImage image;
+    while (m_corerenderer->takeCompletedFrame(&frame, &image, &m_dirtyRect)) {
+        m_img = image;
+        m_lastRenderedFrame = frame;
+        sink(frame, image);
+        delivered++;
+    }
+    return delivered;
+}
+
+void QmlRenderer::flushReadbacks()
+{
+    QMutexLocker lock(m_corerenderer->mutex());
+    m_corerenderer->requestFlush();
+    m_corerenderer->cond()->wait(m_corerenderer->mutex());
 }
 
 void QmlRenderer::polishSyncRender()
 {
     // Polishing happens on the main thread
-    m_renderControl->polishItems();
-    // Sync and render happens on the render thread with the main thread (this one) blocked
+    {
+        QML_RENDER_STAGE(&m_stats, Polish, m_currentFrame);
+        m_renderControl->polishItems();
+    }
+    // An empty rect reads back everything
+    QRect dirtyRect;
+    if (m_partialReadback) {
+        // A scene change no tracked item accounts for (a transform, a border, ...) covers the whole scene
+        if (!m_dirtyTracker->hasChanges()) {
+            m_dirtyTracker->invalidate();
+        }
+        // The scale of the content item is part of the scene coordinates, which
+        // therefore already are FBO pixels
+        dirtyRect = m_dirtyTracker->takeDirtyRect(m_size * m_dpr);
+    }
+    // Sync and render happens on the render thread with the main thread (this one) blocked,
+    // the wait less the sync and render the render thread records is the cost of the handoff
+    QML_RENDER_STAGE(&m_stats, Wait, m_currentFrame);
     QMutexLocker lock(m_corerenderer->mutex());
+    m_corerenderer->setFrameNumber(m_currentFrame);
+    m_corerenderer->setDirtyRect(dirtyRect);
     m_corerenderer->requestRender();
-    // Wait until sync and render is complete
+    // Wait until sync and render is complete, or only the sync when pipelined
     m_corerenderer->cond()->wait(m_corerenderer->mutex());
+    m_sceneDirty = false;
+}
+
+bool QmlRenderer::sceneUnchanged() const
+{
+    // Output written straight into a caller's buffer has no image to hand out again
+    return !m_sceneDirty && !m_animationDriver->isRunning() && !m_corerenderer->hasTarget();
 }
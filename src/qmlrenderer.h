@@ -39,13 +39,21 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QEvent>
 #include <QtConcurrent/QtConcurrent>
 #include <QQmlError>
+#include <QQmlContext>
 #include <QFuture>
 #include <QQuickWindow>
 #include <QThread>
 #include <QEventLoop>
 #include <QtCore/QAnimationDriver>
+#include <functional>
 
 #include "qmlcorerenderer.h"
+#include "qmlcomponentcache.h"
+#include "qmlpixelconverter.h"
+#include "qmlscenesnapshot.h"
+#include "qmlframecache.h"
+#include "qmldirtytracker.h"
+#include "qmlrenderstats.h"
 
 typedef int32_t mlt_position;
 
@@ -56,6 +64,15 @@ class QmlRenderer: public QObject
 
 public:
     explicit QmlRenderer(QString qmlFileUrlString, int fps, int duration, QObject *parent = nullptr);
+    /*
+     * Uses engine instead of a private one, so renderers living on the engine's
+     * thread share its compiled components and imports. The engine is not owned
+     * and must outlive the renderer. Being on one thread, these renderers also
+     * share its animation driver: only one of them holds a session at a time,
+     * rendering in turns reloads the scene (from the shared components) on every
+     * switch, see setSessionMode().
+     */
+    QmlRenderer(QString qmlFileUrlString, int fps, int duration, QQmlEngine *engine, QObject *parent = nullptr);
 
     ~QmlRenderer() override;
 
@@ -64,8 +81,158 @@ public:
         Initialised
     };
 
+    // Receives every frame of a batch render as soon as it has been read back
+    typedef std::function<void(int frame, const QImage &image)> FrameSink;
+    // Receives all outputs of a frame of a multi resolution render, in the order of the sizes
+    typedef std::function<void(int frame, const QVector<QImage> &images)> MultiFrameSink;
+
+    /*
+     * Size and format may change from one call to the next. The live scene is
+     * then resized like a resized window, keeping the loaded template and the
+     * state of its animations, so switching between proxy and full resolution
+     * does not reload anything.
+     */
     QImage render(int width, int height, QImage::Format format);
     QImage render(int width, int height, QImage::Format format, int frame);
+    /*
+     * Renders frame straight into caller owned memory (e.g. an mlt_frame image) of
+     * width x height pixels in the given format, doing the vertical flip and format
+     * conversion in the same pass that copies the pixels out of the readback
+     * buffer. No QImage is produced. Returns false, leaving the buffer untouched, for
+     * frames outside the clip and with a device pixel ratio other than 1.
+     */
+    bool render(int width, int height, QImage::Format format, int frame, uchar *buffer, int bytesPerLine);
+    // Same for the planar and byte order formats of QmlPixelConverter, e.g. YUV420P
+    bool render(int width, int height, QmlPixelConverter::PixelFormat format, int frame, const QmlPixelConverter::Plane *planes);
+    /*
+     * Renders frames first to last (inclusive, clamped to the clip length) in one
+     * tight polish/sync/render loop and hands each one to sink. Returns the number
+     * of frames rendered. Follows the same session rules as render().
+     */
+    int renderRange(int width, int height, QImage::Format format, int first, int last, const FrameSink &sink);
+    /*
+     * One scene evaluation, several outputs, e.g. a full size render with its
+     * proxy and thumbnail. The scene is laid out and rendered at sizes[0], the
+     * other outputs are area averaged from that frame, sizes[i] pixels each.
+     */
+    QVector<QImage> render(const QVector<QSize> &sizes, QImage::Format format, int frame);
+    int renderRange(const QVector<QSize> &sizes, QImage::Format format, int first, int last, const MultiFrameSink &sink);
+    /*
+     * Batch renders read frames back through a ring of pixel buffer objects so the
+     * readback of one frame overlaps with rendering the next. Enabled by default.
+     */
+    void setAsyncReadback(bool enabled) { m_asyncReadback = enabled; }
+    /*
+     * With asynchronous readback, batch renders are pipelined: the main thread only
+     * waits for the scene to be synced, then advances and polishes the next frame
+     * while the render thread renders and reads back the current one. Enabled by default.
+     */
+    void setPipelinedRendering(bool enabled) { m_pipelinedRendering = enabled; }
+    // Brings the scene back to its initial state, reusing the cached compiled component
+    void reset();
+    /*
+     * Drops the scene and animation driver but keeps the context, window, engine
+     * and render thread, so the renderer can take on another job without paying
+     * for their creation again. The next render() loads the scene anew.
+     */
+    void release();
+    // Releases the scene and points the renderer at another QML file
+    void setSource(const QString &qmlFileUrlString, int fps, int duration);
+    // Initialises the render control ahead of the first render()
+    void warmUp();
+    /*
+     * Hands the renderer, its window, engine and context over to thread, which
+     * from then on is the only one to render with it. Called on the thread that
+     * created the renderer, before the first render(). The offscreen surface
+     * stays on the creating thread, so thread moves the renderer back with
+     * another call when done and the creating thread destroys it.
+     */
+    void moveRendererToThread(QThread *thread);
+    /*
+     * Sets properties of the root object, e.g. the texts and colours of a title
+     * template. They are written to the live scene right away and to every item
+     * tree created later, before its bindings are evaluated, so rendering
+     * variants of a template needs no reload. Keys already set keep their last
+     * value, properties() returns all of them. Animations that already started
+     * keep the values they started with, reset() first to replay them.
+     */
+    void setProperties(const QVariantMap &properties);
+    QVariantMap properties() const { return m_properties; }
+    // Same for context properties of the scene
+    void setContextProperties(const QVariantMap &properties);
+    QVariantMap contextProperties() const { return m_contextProperties; }
+    // Where the compiled template of the current scene came from
+    QmlComponentCache::LoadSource loadSource() const { return m_loadSource; }
+    // Sets a fractional frame rate such as 30000/1001, the clip keeps its duration
+    void setFrameRate(int numerator, int denominator);
+    /*
+     * Output images are width x height times ratio pixels, the scene is scaled
+     * up to fill them. Text is rasterised at the device pixel ratio of the window,
+     * which comes from the platform (e.g. QT_SCALE_FACTOR), so that should match
+     * for the sharpest glyphs.
+     */
+    void setDevicePixelRatio(qreal ratio);
+    qreal devicePixelRatio() const { return m_dpr; }
+    /*
+     * Checkpoints the scene every frames frames while rendering forward, so a
+     * backwards seek can restart from the nearest checkpoint.
+     * 0 (the default) disables snapshots. Memory used for them is bounded by
+     * setSnapshotMemoryLimit().
+     */
+    void setSnapshotInterval(int frames) { m_snapshots.setInterval(frames); }
+    void setSnapshotMemoryLimit(qint64 bytes) { m_snapshots.setMemoryLimit(bytes); }
+    int snapshotCount() const { return m_snapshots.count(); }
+    /*
+     * Serves repeated requests for the same frame from cache instead of rendering
+     * it again, and stores every frame rendered to a QImage or packed buffer. The
+     * cache is not owned and can be shared between renderers, nullptr (the
+     * default) disables caching.
+     */
+    void setFrameCache(QmlFrameCache *cache) { m_frameCache = cache; }
+    QmlFrameCache *frameCache() const { return m_frameCache; }
+    /*
+     * Number of frames returned without a sync, render and readback because no
+     * animation was running and nothing in the scene changed since the frame
+     * before, e.g. every frame after the first of a template without animations.
+     */
+    int staticFramesServed() const { return m_staticFramesServed; }
+    /*
+     * With partial readback, only the part of the scene whose items changed is
+     * read back from the GPU and patched into the previous image. Changes are
+     * followed through the notify signals of the items, which miss transforms,
+     * border and gradient changes, layers and shaders drawing outside their
+     * item and painted items, so it is off by default and only suits templates
+     * that animate plain item properties. A scene change without any tracked
+     * item change reads back everything.
+     */
+    void setPartialReadback(bool enabled);
+    bool partialReadback() const { return m_partialReadback; }
+    /*
+     * The pixels of the image last returned or handed to a sink that were read
+     * back, so compositors can skip the rest. Empty when the frame did not change
+     * at all, the whole image without partial readback.
+     */
+    QRect dirtyRect() const { return m_dirtyRect; }
+    /*
+     * Timings of the advance, polish, wait, sync, render, flush, readback and
+     * convert stage of every frame, on both threads. Recording is off until
+     * stats()->setEnabled(true).
+     */
+    QmlRenderStats *stats() { return &m_stats; }
+    /*
+     * In session mode (the default) the scene, animation driver and FBO are kept
+     * alive between render() calls, so requesting a frame after the last rendered
+     * one only advances the animation by the difference. Only a backwards seek
+     * rewinds the animation to the first frame. With session mode disabled every
+     * call replays the animation from the first frame.
+     *
+     * Animations are driven per thread, so only one renderer per thread holds a
+     * session at a time. Rendering with another renderer on the same thread
+     * releases the session of the previous one, which reloads its scene on its
+     * next render.
+     */
+    void setSessionMode(bool enabled) { m_sessionMode = enabled; }
+    bool sessionMode() const { return m_sessionMode; }
     void checkCurrentContex() {    m_context->currentContext() == nullptr? qDebug() << "1 Context is Null ": qDebug() << "2 A context was made current!"; }
     void checkifAnimDriverRunning() { m_animationDriver->isRunning()? qDebug() << " 1 driver running": qDebug() << "2  driver is NOT running :)"; }
 
@@ -75,24 +242,47 @@ protected:
 private:
     void initDriver();
     void resetDriver();
+    void startPendingAnimations();
+    void advanceTo(mlt_position frame);
     void init(int width, int height, QImage::Format imageFormat);
+    void resize(const QSize &size, QImage::Format imageFormat);
     void loadInput();
+    void createRootItem();
+    void applyGeometry();
+    bool canRenderInto(int frame) const;
+    void rewind();
+    void prepareSeek(mlt_position frame);
+    void flushReadbacks();
+    int deliverCompletedFrames(const FrameSink &sink);
+    QVector<QImage> scaledOutputs(const QImage &master, const QVector<QSize> &sizes, QImage::Format format);
     void polishSyncRender();
+    bool sceneUnchanged() const;
     bool loadRootObject();
+    void applyProperties(QObject *rootObject);
+    void propertiesChanged();
     bool checkQmlComponent();
     void renderStatic();
     void renderAnimated();
+    void renderFrame(mlt_position frame);
+    QmlFrameCache::Key cacheKey(int width, int height, QImage::Format format, int frame);
 
     QOpenGLContext *m_context;
     QOffscreenSurface *m_offscreenSurface;
     QQuickRenderControl* m_renderControl;
     QQuickWindow *m_quickWindow;
     QQmlEngine *m_qmlEngine;
+    QQmlContext *m_qmlContext;
+    bool m_ownsEngine;
+    QmlComponentCache::LoadSource m_loadSource;
+    QVariantMap m_properties;
+    QVariantMap m_contextProperties;
+    QByteArray m_propertiesKey;
     QQmlComponent *m_qmlComponent;
     QQuickItem *m_rootItem;
     QOpenGLFramebufferObject *m_fbo;
     QmlAnimationDriver *m_animationDriver;
     QmlCoreRenderer *m_corerenderer;
+    QmlDirtyTracker *m_dirtyTracker;
     QThread *m_rendererThread;
 
     qreal m_dpr;
@@ -101,12 +291,29 @@ private:
     int m_duration;
     int m_fps;
     int m_framesCount;
+    int m_fpsNumerator;
+    int m_fpsDenominator;
     mlt_position m_currentFrame;
     QUrl m_qmlFileUrl;
     QImage m_frame;
     mlt_position m_requestedFrame;
+    mlt_position m_lastRenderedFrame;
+    bool m_sessionMode;
+    bool m_asyncReadback;
+    bool m_pipelinedRendering;
+    bool m_partialReadback;
+    bool m_sceneDirty;
+    bool m_renderControlInitialised;
+    int m_staticFramesServed;
+    QRect m_dirtyRect;
+    QmlRenderStats m_stats;
+    QmlSnapshotStore m_snapshots;
+    QmlFrameCache *m_frameCache;
     QImage::Format m_ImageFormat;
     QImage m_img;
+    // Outputs of the last multi resolution frame, handed out again for an unchanged frame
+    qint64 m_outputsKey;
+    QVector<QImage> m_outputs;
     mlt_position m_totalFrames;
     QWaitCondition m_cond;
     QMutex m_mutex;
@@ -0,0 +1,118 @@
+/*
+Copyright (C) 2019  Akhil K Gangadharan <helloimakhil@gmail.com>
+This file is part of Kdenlive. See www.kdenlive.org.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of
+the License or (at your option) version 3 or any later version
+accepted by the membership of KDE e.V. (or its successor approved
+by the membership of KDE e.V.), which shall act as a proxy
+defined in Section 14 of version 3 of the license.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "qmlrendererpool.h"
+
+#include <QDebug>
+#include <QThread>
+
+QmlRendererPool::QmlRendererPool(int warmCount, QQmlEngine *engine, QObject *parent)
+    : QObject(parent)
+    , m_engine(engine)
+    , m_warmCount(qMax(0, warmCount))
+    , m_idleTimeout(30000)
+    , m_created(0)
+{
+    for (int i = 0; i < m_warmCount; ++i) {
+        QmlRenderer *renderer = createRenderer();
+        m_idle.append(Idle{renderer, QElapsedTimer()});
+        m_idle.last().since.start();
+    }
+
+    m_evictionTimer.setInterval(m_idleTimeout / 2);
+    connect(&m_evictionTimer, &QTimer::timeout, this, &QmlRendererPool::evictIdle);
+    m_evictionTimer.start();
+}
+
+QmlRendererPool::~QmlRendererPool()
+{
+    for (const Idle &idle : qAsConst(m_idle)) {
+        delete idle.renderer;
+    }
+    if (!m_leased.isEmpty()) {
+        qWarning() << "QmlRendererPool destroyed with" << m_leased.count() << "renderers still leased";
+    }
+    qDeleteAll(m_leased);
+}
+
+QmlRenderer *QmlRendererPool::acquire(const QString &qmlFileUrlString, int fps, int duration)
+{
+    Q_ASSERT_X(thread() == QThread::currentThread(), "QmlRendererPool::acquire", "renderers are used on the thread of the pool");
+    QmlRenderer *renderer;
+    if (!m_idle.isEmpty()) {
+        // The most recently used renderer is the likeliest to still be in caches
+        renderer = m_idle.takeLast().renderer;
+    } else {
+        renderer = createRenderer();
+    }
+    renderer->setSource(qmlFileUrlString, fps, duration);
+    m_leased.insert(renderer);
+    return renderer;
+}
+
+void QmlRendererPool::release(QmlRenderer *renderer)
+{
+    Q_ASSERT_X(thread() == QThread::currentThread(), "QmlRendererPool::release", "renderers are used on the thread of the pool");
+    if (!m_leased.remove(renderer)) {
+        qWarning() << "QmlRendererPool: renderer" << renderer << "was not leased from this pool";
+        return;
+    }
+
+    // The next job starts from a clean renderer with the default options
+    // (properties and the frame rate are reset by setSource() in acquire())
+    renderer->release();
+    renderer->setSessionMode(true);
+    renderer->setAsyncReadback(true);
+    renderer->setPipelinedRendering(true);
+    renderer->setPartialReadback(false);
+    renderer->setDevicePixelRatio(1.0);
+    renderer->setSnapshotInterval(0);
+    renderer->setSnapshotMemoryLimit(QmlSnapshotStore::DefaultMemoryLimit);
+    renderer->setFrameCache(nullptr);
+    renderer->stats()->setEnabled(false);
+    renderer->stats()->setTraceCapacity(QmlRenderStats::DefaultTraceCapacity);
+    renderer->stats()->reset();
+
+    m_idle.append(Idle{renderer, QElapsedTimer()});
+    m_idle.last().since.start();
+}
+
+void QmlRendererPool::setIdleTimeout(int msecs)
+{
+    m_idleTimeout = qMax(0, msecs);
+    m_evictionTimer.setInterval(qMax(1, m_idleTimeout / 2));
+}
+
+void QmlRendererPool::evictIdle()
+{
+    // Oldest first, the warm renderers are always kept
+    while (m_idle.count() > m_warmCount && m_idle.first().since.hasExpired(m_idleTimeout)) {
+        delete m_idle.takeFirst().renderer;
+    }
+}
+
+QmlRenderer *QmlRendererPool::createRenderer()
+{
+    QmlRenderer *renderer = new QmlRenderer(QString(), 25, 0, m_engine);
+    renderer->warmUp();
+    m_created++;
+    return renderer;
+}
@@ -0,0 +1,86 @@
+/*
+Copyright (C) 2019  Akhil K Gangadharan <helloimakhil@gmail.com>
+This file is part of Kdenlive. See www.kdenlive.org.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of
+the License or (at your option) version 3 or any later version
+accepted by the membership of KDE e.V. (or its successor approved
+by the membership of KDE e.V.), which shall act as a proxy
+defined in Section 14 of version 3 of the license.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef QMLRENDERERPOOL_H
+#define QMLRENDERERPOOL_H
+
+#include "qmlrenderer.h"
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QList>
+#include <QSet>
+#include <QTimer>
+
+/*
+ * Keeps renderers with their context, window, engine and render thread alive
+ * between jobs, since creating and tearing those down costs far more than
+ * rendering a short clip. acquire() leases an idle renderer (or creates one when
+ * all are busy) and points it at the job's QML file, release() drops the job's
+ * scene and options and puts the renderer back. Idle renderers beyond the warm
+ * count are deleted after idleTimeout() ms.
+ *
+ * Renderers belong to the thread the pool lives in and must be used there. As
+ * only one renderer per thread holds a session (see QmlRenderer::setSessionMode()),
+ * several leases used in turns reload their scene on every switch, so jobs that
+ * run side by side want a pool per thread.
+*/
+class QmlRendererPool : public QObject
+{
+    Q_OBJECT
+
+public:
+    // With an engine, all renderers of the pool share it (it is not owned)
+    explicit QmlRendererPool(int warmCount = 2, QQmlEngine *engine = nullptr, QObject *parent = nullptr);
+    ~QmlRendererPool() override;
+
+    QmlRenderer *acquire(const QString &qmlFileUrlString, int fps, int duration);
+    void release(QmlRenderer *renderer);
+
+    void setIdleTimeout(int msecs);
+    int idleTimeout() const { return m_idleTimeout; }
+    int warmCount() const { return m_warmCount; }
+    int idleCount() const { return m_idle.count(); }
+    int leasedCount() const { return m_leased.count(); }
+    // Renderers created since the pool was, including the warm ones
+    int createdCount() const { return m_created; }
+
+private slots:
+    void evictIdle();
+
+private:
+    struct Idle {
+        QmlRenderer *renderer;
+        QElapsedTimer since;
+    };
+
+    QmlRenderer *createRenderer();
+
+    QList<Idle> m_idle;
+    QSet<QmlRenderer *> m_leased;
+    QTimer m_evictionTimer;
+    QQmlEngine *m_engine;
+    int m_warmCount;
+    int m_idleTimeout;
+    int m_created;
+};
+
+#endif // QMLRENDERERPOOL_H
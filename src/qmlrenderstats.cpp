@@ -0,0 +1,170 @@
+/*
+Copyright (C) 2019  Akhil K Gangadharan <helloimakhil@gmail.com>
+This file is part of Kdenlive. See www.kdenlive.org.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of
+the License or (at your option) version 3 or any later version
+accepted by the membership of KDE e.V. (or its successor approved
+by the membership of KDE e.V.), which shall act as a proxy
+defined in Section 14 of version 3 of the license.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "qmlrenderstats.h"
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QThread>
+#include <QtAlgorithms>
+
+QmlRenderStats::QmlRenderStats()
+    : m_enabled(0)
+    , m_traceCapacity(DefaultTraceCapacity)
+{
+    m_clock.start();
+    reset();
+}
+
+void QmlRenderStats::setTraceCapacity(int events)
+{
+    QMutexLocker lock(&m_mutex);
+    m_traceCapacity = qMax(0, events);
+    if (m_events.size() > m_traceCapacity) {
+        m_events.resize(m_traceCapacity);
+    }
+}
+
+void QmlRenderStats::record(Stage stage, qint64 start, qint64 end, int frame)
+{
+    const qint64 duration = end - start;
+    const quintptr thread = quintptr(QThread::currentThreadId());
+
+    QMutexLocker lock(&m_mutex);
+    Histogram &histogram = m_histograms[stage];
+    histogram.buckets[bucket(duration)]++;
+    histogram.count++;
+    histogram.total += duration;
+    histogram.min = histogram.count == 1 ? duration : qMin(histogram.min, duration);
+    histogram.max = qMax(histogram.max, duration);
+    // Later events are dropped once the trace is full, the histograms go on
+    if (m_events.size() < m_traceCapacity) {
+        m_events.append(Event{start, duration, thread, frame, stage});
+    }
+}
+
+QmlRenderStats::Summary QmlRenderStats::summary(Stage stage) const
+{
+    QMutexLocker lock(&m_mutex);
+    const Histogram &histogram = m_histograms[stage];
+    Summary summary;
+    summary.count = histogram.count;
+    summary.total = histogram.total;
+    summary.min = histogram.min;
+    summary.max = histogram.max;
+    summary.p50 = percentile(histogram, 50);
+    summary.p95 = percentile(histogram, 95);
+    summary.p99 = percentile(histogram, 99);
+    return summary;
+}
+
+const char *QmlRenderStats::stageName(Stage stage)
+{
+    static const char *const names[StageCount] = {
+        "advance", "polish", "wait", "sync", "render", "flush", "readback", "convert"
+    };
+    return stage >= 0 && stage < StageCount ? names[stage] : "unknown";
+}
+
+QByteArray QmlRenderStats::chromeTrace() const
+{
+    QMutexLocker lock(&m_mutex);
+    QJsonArray events;
+    for (const Event &event : m_events) {
+        QJsonObject json;
+        json.insert(QStringLiteral("name"), QLatin1String(stageName(event.stage)));
+        json.insert(QStringLiteral("ph"), QStringLiteral("X"));
+        // Microseconds, with fractions
+        json.insert(QStringLiteral("ts"), event.start / 1000.0);
+        json.insert(QStringLiteral("dur"), event.duration / 1000.0);
+        json.insert(QStringLiteral("pid"), 1);
+        json.insert(QStringLiteral("tid"), double(event.thread));
+        json.insert(QStringLiteral("args"), QJsonObject{{QStringLiteral("frame"), event.frame}});
+        events.append(json);
+    }
+    QJsonObject trace;
+    trace.insert(QStringLiteral("traceEvents"), events);
+    trace.insert(QStringLiteral("displayTimeUnit"), QStringLiteral("ms"));
+    return QJsonDocument(trace).toJson(QJsonDocument::Compact);
+}
+
+bool QmlRenderStats::writeChromeTrace(const QString &fileName) const
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    const QByteArray trace = chromeTrace();
+    return file.write(trace) == trace.size();
+}
+
+void QmlRenderStats::reset()
+{
+    QMutexLocker lock(&m_mutex);
+    for (Histogram &histogram : m_histograms) {
+        histogram.buckets.fill(0, BucketCount);
+        histogram.count = 0;
+        histogram.total = 0;
+        histogram.min = 0;
+        histogram.max = 0;
+    }
+    m_events.clear();
+}
+
+int QmlRenderStats::bucket(qint64 duration)
+{
+    // Below 8 ns one bucket per value, above eight per power of two
+    if (duration < 8) {
+        return int(qMax<qint64>(0, duration));
+    }
+    const int msb = 63 - qCountLeadingZeroBits(quint64(duration));
+    const int fraction = int(duration >> (msb - 3)) & 7;
+    return qMin(msb * 8 + fraction, int(BucketCount) - 1);
+}
+
+qint64 QmlRenderStats::bucketValue(int bucket)
+{
+    if (bucket < 8) {
+        return bucket;
+    }
+    // Middle of the bucket
+    const int msb = bucket / 8;
+    const qint64 lower = qint64(8 + bucket % 8) << (msb - 3);
+    return lower + (qint64(1) << (msb - 3)) / 2;
+}
+
+qint64 QmlRenderStats::percentile(const Histogram &histogram, int percent)
+{
+    if (histogram.count == 0) {
+        return 0;
+    }
+    const qint64 rank = (qint64(histogram.count) * percent + 99) / 100;
+    qint64 seen = 0;
+    for (int i = 0; i < histogram.buckets.size(); ++i) {
+        seen += histogram.buckets.at(i);
+        if (seen >= rank) {
+            return qBound(histogram.min, bucketValue(i), histogram.max);
+        }
+    }
+    return histogram.max;
+}
@@ -0,0 +1,147 @@
+/*
+Copyright (C) 2019  Akhil K Gangadharan <helloimakhil@gmail.com>
+This file is part of Kdenlive. See www.kdenlive.org.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of
+the License or (at your option) version 3 or any later version
+accepted by the membership of KDE e.V. (or its successor approved
+by the membership of KDE e.V.), which shall act as a proxy
+defined in Section 14 of version 3 of the license.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef QMLRENDERSTATS_H
+#define QMLRENDERSTATS_H
+
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+
+/*
+ * Per frame timings of the stages of a render, recorded from the main and the
+ * render thread while enabled. Every stage keeps a log scale histogram (eight
+ * buckets per power of two, so percentiles are accurate to about 6%), and the
+ * individual intervals are kept as trace events up to traceCapacity(), to be
+ * opened in chrome://tracing or Perfetto.
+ *
+ * Disabled (the default), a stage costs one relaxed atomic load. Built with
+ * QMLRENDERER_NO_INSTRUMENTATION defined, the timers are compiled out.
+*/
+class QmlRenderStats
+{
+public:
+    enum Stage {
+        Advance,    // animation driver step and posted animation events
+        Polish,     // QQuickRenderControl::polishItems()
+        Wait,       // main thread blocked on the render thread
+        Sync,       // QQuickRenderControl::sync()
+        Render,     // QQuickRenderControl::render()
+        Flush,      // glFlush()
+        Readback,   // glReadPixels and mapping of pixel buffers
+        Convert,    // flip and pixel format conversion
+        StageCount
+    };
+
+    struct Summary {
+        int count;
+        qint64 total;   // all times in nanoseconds
+        qint64 min;
+        qint64 max;
+        qint64 p50;
+        qint64 p95;
+        qint64 p99;
+    };
+
+    enum { DefaultTraceCapacity = 100000 };
+
+    QmlRenderStats();
+
+    void setEnabled(bool enabled) { m_enabled.store(enabled ? 1 : 0); }
+    bool isEnabled() const { return m_enabled.load() != 0; }
+    void setTraceCapacity(int events);
+    int traceCapacity() const { return m_traceCapacity; }
+
+    qint64 now() const { return m_clock.nsecsElapsed(); }
+    void record(Stage stage, qint64 start, qint64 end, int frame);
+
+    Summary summary(Stage stage) const;
+    static const char *stageName(Stage stage);
+    // Chrome trace event format, one complete event per recorded stage
+    QByteArray chromeTrace() const;
+    bool writeChromeTrace(const QString &fileName) const;
+    void reset();
+
+private:
+    enum { BucketCount = 64 * 8 };
+
+    struct Event {
+        qint64 start;
+        qint64 duration;
+        quintptr thread;
+        int frame;
+        Stage stage;
+    };
+    struct Histogram {
+        QVector<quint32> buckets;
+        int count;
+        qint64 total;
+        qint64 min;
+        qint64 max;
+    };
+
+    static int bucket(qint64 duration);
+    static qint64 bucketValue(int bucket);
+    static qint64 percentile(const Histogram &histogram, int percent);
+
+    QAtomicInt m_enabled;
+    QElapsedTimer m_clock;
+    mutable QMutex m_mutex;
+    Histogram m_histograms[StageCount];
+    QVector<Event> m_events;
+    int m_traceCapacity;
+};
+
+// Records the lifetime of the timer as one stage, if stats is enabled
+class QmlStageTimer
+{
+public:
+    QmlStageTimer(QmlRenderStats *stats, QmlRenderStats::Stage stage, int frame)
+        : m_stats(stats && stats->isEnabled() ? stats : nullptr)
+        , m_stage(stage)
+        , m_frame(frame)
+        , m_start(m_stats ? m_stats->now() : 0)
+    {
+    }
+    ~QmlStageTimer()
+    {
+        if (m_stats) {
+            m_stats->record(m_stage, m_start, m_stats->now(), m_frame);
+        }
+    }
+
+private:
+    QmlRenderStats *m_stats;
+    QmlRenderStats::Stage m_stage;
+    int m_frame;
+    qint64 m_start;
+};
+
+#ifdef QMLRENDERER_NO_INSTRUMENTATION
+#define QML_RENDER_STAGE(stats, stage, frame)
+#else
+#define QML_RENDER_STAGE(stats, stage, frame) QmlStageTimer stageTimer(stats, QmlRenderStats::stage, frame)
+#endif
+
+#endif // QMLRENDERSTATS_H
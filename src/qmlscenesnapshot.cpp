@@ -0,0 +1,180 @@
+/*
+Copyright (C) 2019  Akhil K Gangadharan <helloimakhil@gmail.com>
+This file is part of Kdenlive. See www.kdenlive.org.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of
+the License or (at your option) version 3 or any later version
+accepted by the membership of KDE e.V. (or its successor approved
+by the membership of KDE e.V.), which shall act as a proxy
+defined in Section 14 of version 3 of the license.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "qmlscenesnapshot.h"
+#include <QMetaProperty>
+#include <QQmlProperty>
+#include <private/qqmlproperty_p.h>
+
+static bool isSnapshotProperty(const QMetaProperty &property)
+{
+    if (!property.isReadable() || !property.isWritable() || !property.isStored()) {
+        return false;
+    }
+    // Object references, lists and script values belong to the item tree itself
+    const int type = property.userType();
+    if (type == QMetaType::UnknownType || (QMetaType::typeFlags(type) & QMetaType::PointerToQObject)) {
+        return false;
+    }
+    const QByteArray typeName(property.typeName());
+    return !typeName.startsWith("QQmlListProperty") && typeName != "QJSValue" && typeName != "QQmlComponent*";
+}
+
+static qint64 valueSize(const QVariant &value)
+{
+    switch (value.userType()) {
+    case QMetaType::QString:
+        return value.toString().size() * 2;
+    case QMetaType::QByteArray:
+        return value.toByteArray().size();
+    default:
+        return 16;
+    }
+}
+
+QmlSceneSnapshot::QmlSceneSnapshot()
+    : m_frame(-1)
+    , m_byteSize(0)
+{
+}
+
+QmlSceneSnapshot QmlSceneSnapshot::capture(QQuickItem *root, qint64 frame)
+{
+    QmlSceneSnapshot snapshot;
+    snapshot.m_frame = frame;
+    QVector<int> path;
+    captureItem(root, path, snapshot);
+    return snapshot;
+}
+
+void QmlSceneSnapshot::captureItem(QQuickItem *item, QVector<int> &path, QmlSceneSnapshot &snapshot)
+{
+    const QMetaObject *metaObject = item->metaObject();
+    for (int i = 0; i < metaObject->propertyCount(); ++i) {
+        const QMetaProperty property = metaObject->property(i);
+        if (!isSnapshotProperty(property)) {
+            continue;
+        }
+        const QVariant value = property.read(item);
+        snapshot.m_values.append(Value{path, i, value});
+        snapshot.m_byteSize += qint64(sizeof(Value)) + path.size() * qint64(sizeof(int)) + valueSize(value);
+    }
+
+    const QList<QQuickItem *> children = item->childItems();
+    for (int i = 0; i < children.size(); ++i) {
+        path.append(i);
+        captureItem(children.at(i), path, snapshot);
+        path.removeLast();
+    }
+}
+
+QQuickItem *QmlSceneSnapshot::itemAt(QQuickItem *root, const QVector<int> &path)
+{
+    QQuickItem *item = root;
+    for (int index : path) {
+        const QList<QQuickItem *> children = item->childItems();
+        if (index >= children.size()) {
+            return nullptr;
+        }
+        item = children.at(index);
+    }
+    return item;
+}
+
+void QmlSceneSnapshot::restore(QQuickItem *root) const
+{
+    QQuickItem *item = nullptr;
+    const QVector<int> *itemPath = nullptr;
+    for (const Value &value : m_values) {
+        if (!itemPath || *itemPath != value.path) {
+            itemPath = &value.path;
+            item = itemAt(root, value.path);
+        }
+        // Items created at runtime (Repeater, Loader) may not line up anymore
+        if (!item || value.property >= item->metaObject()->propertyCount()) {
+            continue;
+        }
+        const QMetaProperty property = item->metaObject()->property(value.property);
+        // Writing would remove the binding, its value follows from the restored state
+        if (QQmlPropertyPrivate::binding(QQmlProperty(item, QString::fromLatin1(property.name())))) {
+            continue;
+        }
+        if (property.read(item) != value.value) {
+            property.write(item, value.value);
+        }
+    }
+}
+
+QmlSnapshotStore::QmlSnapshotStore()
+    : m_interval(0)
+    , m_memoryLimit(DefaultMemoryLimit)
+    , m_memoryUsed(0)
+{
+}
+
+void QmlSnapshotStore::setMemoryLimit(qint64 bytes)
+{
+    m_memoryLimit = bytes;
+    evict();
+}
+
+bool QmlSnapshotStore::wants(qint64 frame) const
+{
+    return m_interval > 0 && frame > 0 && frame % m_interval == 0 && !m_snapshots.contains(frame);
+}
+
+void QmlSnapshotStore::insert(const QmlSceneSnapshot &snapshot)
+{
+    if (snapshot.byteSize() > m_memoryLimit) {
+        return;
+    }
+    m_snapshots.insert(snapshot.frame(), snapshot);
+    m_recentlyUsed.append(snapshot.frame());
+    m_memoryUsed += snapshot.byteSize();
+    evict();
+}
+
+bool QmlSnapshotStore::nearest(qint64 frame, QmlSceneSnapshot *snapshot)
+{
+    auto it = m_snapshots.upperBound(frame);
+    if (it == m_snapshots.begin()) {
+        return false;
+    }
+    --it;
+    m_recentlyUsed.removeOne(it.key());
+    m_recentlyUsed.append(it.key());
+    *snapshot = it.value();
+    return true;
+}
+
+void QmlSnapshotStore::clear()
+{
+    m_snapshots.clear();
+    m_recentlyUsed.clear();
+    m_memoryUsed = 0;
+}
+
+void QmlSnapshotStore::evict()
+{
+    while (m_memoryUsed > m_memoryLimit && !m_recentlyUsed.isEmpty()) {
+        m_memoryUsed -= m_snapshots.take(m_recentlyUsed.takeFirst()).byteSize();
+    }
+}
@@ -0,0 +1,97 @@
+/*
+Copyright (C) 2019  Akhil K Gangadharan <helloimakhil@gmail.com>
+This file is part of Kdenlive. See www.kdenlive.org.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of
+the License or (at your option) version 3 or any later version
+accepted by the membership of KDE e.V. (or its successor approved
+by the membership of KDE e.V.), which shall act as a proxy
+defined in Section 14 of version 3 of the license.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef QMLSCENESNAPSHOT_H
+#define QMLSCENESNAPSHOT_H
+
+#include <QList>
+#include <QMap>
+#include <QVariant>
+#include <QVector>
+#include <QQuickItem>
+
+/*
+ * The property values of every item of a scene at one frame. Restoring is meant
+ * for a freshly created item tree whose animation clock has already been moved
+ * to the snapshot frame: only properties without an active binding are written,
+ * and only when their value still differs, so bindings keep working while state
+ * built up by scripts and signal handlers is brought back.
+*/
+class QmlSceneSnapshot
+{
+public:
+    QmlSceneSnapshot();
+
+    static QmlSceneSnapshot capture(QQuickItem *root, qint64 frame);
+    void restore(QQuickItem *root) const;
+
+    qint64 frame() const { return m_frame; }
+    qint64 byteSize() const { return m_byteSize; }
+
+private:
+    struct Value {
+        QVector<int> path;      // child item indices from the root
+        int property;
+        QVariant value;
+    };
+
+    static void captureItem(QQuickItem *item, QVector<int> &path, QmlSceneSnapshot &snapshot);
+    static QQuickItem *itemAt(QQuickItem *root, const QVector<int> &path);
+
+    QVector<Value> m_values;
+    qint64 m_frame;
+    qint64 m_byteSize;
+};
+
+/*
+ * Snapshots taken every interval frames during forward rendering, bounded by a
+ * memory limit. The least recently used snapshot is dropped first.
+*/
+class QmlSnapshotStore
+{
+public:
+    enum { DefaultMemoryLimit = 16 * 1024 * 1024 };
+
+    QmlSnapshotStore();
+
+    void setInterval(int frames) { m_interval = qMax(0, frames); clear(); }
+    int interval() const { return m_interval; }
+    void setMemoryLimit(qint64 bytes);
+    qint64 memoryUsed() const { return m_memoryUsed; }
+    int count() const { return m_snapshots.count(); }
+
+    bool wants(qint64 frame) const;
+    void insert(const QmlSceneSnapshot &snapshot);
+    // The latest snapshot at or before frame, false if there is none
+    bool nearest(qint64 frame, QmlSceneSnapshot *snapshot);
+    void clear();
+
+private:
+    void evict();
+
+    QMap<qint64, QmlSceneSnapshot> m_snapshots;
+    QList<qint64> m_recentlyUsed;
+    int m_interval;
+    qint64 m_memoryLimit;
+    qint64 m_memoryUsed;
+};
+
+#endif // QMLSCENESNAPSHOT_H
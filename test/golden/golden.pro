@@ -0,0 +1,15 @@
+TEMPLATE = app
+TARGET = goldentest
+INCLUDEPATH += ../../src
+DEPENDSPATH += ../../src
+DESTDIR = ../../bin
+win32: LIBS += -L../../bin
+else: LIBS += -L../../lib
+LIBS += -lQmlRenderer
+
+QT = core testlib qml quick
+CONFIG += depend_includepath testcase
+CONFIG -= app_bundle
+DEFINES += GOLDEN_SOURCE_DIR=\\\"$$PWD/../..\\\" GOLDEN_DIR=\\\"$$PWD\\\"
+SOURCES += tst_golden.cpp imagecompare.cpp
+HEADERS += tst_golden.h imagecompare.h
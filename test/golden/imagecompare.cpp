@@ -0,0 +1,133 @@
+/*
+Copyright (C) 2019  Akhil K Gangadharan <helloimakhil@gmail.com>
+This file is part of Kdenlive. See www.kdenlive.org.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of
+the License or (at your option) version 3 or any later version
+accepted by the membership of KDE e.V. (or its successor approved
+by the membership of KDE e.V.), which shall act as a proxy
+defined in Section 14 of version 3 of the license.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "imagecompare.h"
+
+#include <QVector>
+#include <QtMath>
+
+static const int WINDOW = 8;
+static const int WINDOW_STEP = 4;
+
+static QImage rgb(const QImage &image)
+{
+    return image.format() == QImage::Format_RGB32 ? image : image.convertToFormat(QImage::Format_RGB32);
+}
+
+static QVector<double> luma(const QImage &image)
+{
+    QVector<double> values(image.width() * image.height());
+    double *out = values.data();
+    for (int y = 0; y < image.height(); ++y) {
+        const QRgb *line = reinterpret_cast<const QRgb *>(image.constScanLine(y));
+        for (int x = 0; x < image.width(); ++x) {
+            // BT.601
+            *out++ = 0.299 * qRed(line[x]) + 0.587 * qGreen(line[x]) + 0.114 * qBlue(line[x]);
+        }
+    }
+    return values;
+}
+
+double ImageCompare::psnr(const QImage &a, const QImage &b)
+{
+    Q_ASSERT(a.size() == b.size());
+    const QImage first = rgb(a);
+    const QImage second = rgb(b);
+    qint64 squaredError = 0;
+    for (int y = 0; y < first.height(); ++y) {
+        const QRgb *lineA = reinterpret_cast<const QRgb *>(first.constScanLine(y));
+        const QRgb *lineB = reinterpret_cast<const QRgb *>(second.constScanLine(y));
+        for (int x = 0; x < first.width(); ++x) {
+            const int red = qRed(lineA[x]) - qRed(lineB[x]);
+            const int green = qGreen(lineA[x]) - qGreen(lineB[x]);
+            const int blue = qBlue(lineA[x]) - qBlue(lineB[x]);
+            squaredError += red * red + green * green + blue * blue;
+        }
+    }
+    if (squaredError == 0) {
+        return qInf();
+    }
+    const double mse = double(squaredError) / (3.0 * first.width() * first.height());
+    return 10.0 * std::log10(255.0 * 255.0 / mse);
+}
+
+double ImageCompare::ssim(const QImage &a, const QImage &b)
+{
+    Q_ASSERT(a.size() == b.size());
+    const int width = a.width();
+    const int height = a.height();
+    if (width < WINDOW || height < WINDOW) {
+        return a == b ? 1.0 : 0.0;
+    }
+    const QVector<double> first = luma(rgb(a));
+    const QVector<double> second = luma(rgb(b));
+    // Stabilising constants of Wang et al. for 8 bit samples
+    const double c1 = (0.01 * 255) * (0.01 * 255);
+    const double c2 = (0.03 * 255) * (0.03 * 255);
+    const double samples = WINDOW * WINDOW;
+
+    double total = 0;
+    int windows = 0;
+    for (int top = 0; top + WINDOW <= height; top += WINDOW_STEP) {
+        for (int left = 0; left + WINDOW <= width; left += WINDOW_STEP) {
+            double sumA = 0, sumB = 0, sumAA = 0, sumBB = 0, sumAB = 0;
+            for (int y = top; y < top + WINDOW; ++y) {
+                const double *lineA = first.constData() + y * width;
+                const double *lineB = second.constData() + y * width;
+                for (int x = left; x < left + WINDOW; ++x) {
+                    sumA += lineA[x];
+                    sumB += lineB[x];
+                    sumAA += lineA[x] * lineA[x];
+                    sumBB += lineB[x] * lineB[x];
+                    sumAB += lineA[x] * lineB[x];
+                }
+            }
+            const double meanA = sumA / samples;
+            const double meanB = sumB / samples;
+            const double varianceA = sumAA / samples - meanA * meanA;
+            const double varianceB = sumBB / samples - meanB * meanB;
+            const double covariance = sumAB / samples - meanA * meanB;
+            total += ((2 * meanA * meanB + c1) * (2 * covariance + c2))
+                / ((meanA * meanA + meanB * meanB + c1) * (varianceA + varianceB + c2));
+            windows++;
+        }
+    }
+    return total / windows;
+}
+
+QImage ImageCompare::difference(const QImage &a, const QImage &b)
+{
+    Q_ASSERT(a.size() == b.size());
+    const QImage first = rgb(a);
+    const QImage second = rgb(b);
+    QImage diff(first.size(), QImage::Format_RGB32);
+    for (int y = 0; y < first.height(); ++y) {
+        const QRgb *lineA = reinterpret_cast<const QRgb *>(first.constScanLine(y));
+        const QRgb *lineB = reinterpret_cast<const QRgb *>(second.constScanLine(y));
+        QRgb *out = reinterpret_cast<QRgb *>(diff.scanLine(y));
+        for (int x = 0; x < first.width(); ++x) {
+            out[x] = qRgb(qMin(255, 8 * qAbs(qRed(lineA[x]) - qRed(lineB[x]))),
+                          qMin(255, 8 * qAbs(qGreen(lineA[x]) - qGreen(lineB[x]))),
+                          qMin(255, 8 * qAbs(qBlue(lineA[x]) - qBlue(lineB[x]))));
+        }
+    }
+    return diff;
+}
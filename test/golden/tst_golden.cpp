@@ -0,0 +1,207 @@
+/*
+Copyright (C) 2019  Akhil K Gangadharan <helloimakhil@gmail.com>
+This file is part of Kdenlive. See www.kdenlive.org.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of
+the License or (at your option) version 3 or any later version
+accepted by the membership of KDE e.V. (or its successor approved
+by the membership of KDE e.V.), which shall act as a proxy
+defined in Section 14 of version 3 of the license.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "tst_golden.h"
+#include "imagecompare.h"
+#include <algorithm>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QGuiApplication>
+#include <QTextStream>
+#include <QThread>
+
+// Below either of these a frame fails
+static const double MIN_PSNR = 40.0;
+static const double MIN_SSIM = 0.99;
+
+Golden::Golden(bool update, int jobs)
+    : m_update(update)
+    , m_jobs(qMax(1, jobs))
+{
+}
+
+QString Golden::key(const QString &name, int frame)
+{
+    return name + QLatin1Char('_') + QString::number(frame);
+}
+
+bool Golden::loadCases(QString *error)
+{
+    QFile file(QStringLiteral(GOLDEN_DIR "/cases.txt"));
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        *error = file.errorString();
+        return false;
+    }
+    QTextStream stream(&file);
+    for (int line = 1; !stream.atEnd(); ++line) {
+        const QString text = stream.readLine().section(QLatin1Char('#'), 0, 0);
+        const QStringList fields = text.split(QLatin1Char(' '), QString::SkipEmptyParts);
+        if (fields.isEmpty()) {
+            continue;
+        }
+        if (fields.size() < 7) {
+            *error = QStringLiteral("cases.txt:%1: expected name, template, width, height, fps, duration and frames").arg(line);
+            return false;
+        }
+        Case c;
+        c.name = fields.at(0);
+        c.file = QStringLiteral(GOLDEN_SOURCE_DIR "/") + fields.at(1);
+        c.size = QSize(fields.at(2).toInt(), fields.at(3).toInt());
+        c.fps = fields.at(4).toInt();
+        c.duration = fields.at(5).toInt();
+        for (int i = 6; i < fields.size(); ++i) {
+            c.frames << fields.at(i).toInt();
+        }
+        // Ascending frames advance the clock instead of seeking
+        std::sort(c.frames.begin(), c.frames.end());
+        m_cases.append(c);
+    }
+    return true;
+}
+
+void Golden::renderCases()
+{
+    // Renderers are created and destroyed here on the GUI thread, see QmlParallelRenderer,
+    // every worker points its renderer at one case after the other
+    QThread *home = QThread::currentThread();
+    QAtomicInt next(0);
+    QVector<QThread *> workers;
+    QVector<QmlRenderer *> renderers;
+    for (int i = 0; i < qMin(m_jobs, m_cases.size()); ++i) {
+        QmlRenderer *renderer = new QmlRenderer(QString(), 25, 1);
+        QThread *worker = QThread::create([this, &next, renderer, home]() {
+            for (int index = next.fetchAndAddRelaxed(1); index < m_cases.size(); index = next.fetchAndAddRelaxed(1)) {
+                const Case &c = m_cases.at(index);
+                renderer->setSource(QUrl::fromLocalFile(c.file).toString(), c.fps, c.duration);
+                for (int frame : c.frames) {
+                    const QImage image = renderer->render(c.size.width(), c.size.height(), QImage::Format_ARGB32, frame);
+                    QMutexLocker lock(&m_mutex);
+                    m_rendered.insert(key(c.name, frame), image);
+                }
+            }
+            renderer->release();
+            renderer->moveRendererToThread(home);
+        });
+        renderer->moveRendererToThread(worker);
+        renderers.append(renderer);
+        workers.append(worker);
+        worker->start();
+    }
+    for (QThread *worker : qAsConst(workers)) {
+        worker->wait();
+        delete worker;
+    }
+    qDeleteAll(renderers);
+}
+
+void Golden::initTestCase()
+{
+    QString error;
+    if (!loadCases(&error)) {
+        QFAIL(qPrintable(error));
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    renderCases();
+    qInfo("Rendered %d frames of %d templates with %d jobs in %lld ms",
+          m_rendered.size(), m_cases.size(), m_jobs, timer.elapsed());
+
+    if (m_update) {
+        QDir dir(QStringLiteral(GOLDEN_DIR "/images"));
+        dir.mkpath(QStringLiteral("."));
+        for (auto it = m_rendered.constBegin(); it != m_rendered.constEnd(); ++it) {
+            // PNG, the goldens must be lossless
+            QVERIFY2(it.value().save(dir.filePath(it.key() + QStringLiteral(".png")), "PNG"), qPrintable(it.key()));
+        }
+        qInfo("Wrote %d golden images to %s", m_rendered.size(), qPrintable(dir.path()));
+    }
+}
+
+void Golden::compare_data()
+{
+    QTest::addColumn<QString>("name");
+    for (const Case &c : qAsConst(m_cases)) {
+        for (int frame : c.frames) {
+            const QString name = key(c.name, frame);
+            QTest::newRow(qPrintable(name)) << name;
+        }
+    }
+}
+
+void Golden::compare()
+{
+    QFETCH(QString, name);
+    if (m_update) {
+        QSKIP("Golden images updated");
+    }
+
+    const QImage actual = m_rendered.value(name);
+    QVERIFY2(!actual.isNull(), "Frame was not rendered");
+    const QString goldenFile = QStringLiteral(GOLDEN_DIR "/images/") + name + QStringLiteral(".png");
+    if (!QFile::exists(goldenFile)) {
+        QFAIL(qPrintable(QStringLiteral("No golden image %1, generate it with -update and commit it").arg(goldenFile)));
+    }
+    const QImage golden(goldenFile);
+    QCOMPARE(actual.size(), golden.size());
+
+    const double psnr = ImageCompare::psnr(actual, golden);
+    const double ssim = ImageCompare::ssim(actual, golden);
+    if (psnr < MIN_PSNR || ssim < MIN_SSIM) {
+        QDir dir(QDir::current().filePath(QStringLiteral("golden_failures")));
+        dir.mkpath(QStringLiteral("."));
+        actual.save(dir.filePath(name + QStringLiteral("_actual.png")));
+        ImageCompare::difference(actual, golden).save(dir.filePath(name + QStringLiteral("_diff.png")));
+        QFAIL(qPrintable(QStringLiteral("PSNR %1 dB, SSIM %2, see %3").arg(psnr, 0, 'f', 2).arg(ssim, 0, 'f', 4).arg(dir.path())));
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    // Headless and independent of the GPU unless asked otherwise
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    if (qEnvironmentVariableIsEmpty("LIBGL_ALWAYS_SOFTWARE")) {
+        qputenv("LIBGL_ALWAYS_SOFTWARE", "1");
+    }
+    QCoreApplication::setAttribute(Qt::AA_UseSoftwareOpenGL);
+    QGuiApplication app(argc, argv);
+
+    // -update and -jobs are ours, everything else goes to QTest
+    bool update = false;
+    int jobs = QThread::idealThreadCount();
+    QStringList args;
+    const QStringList arguments = app.arguments();
+    for (int i = 0; i < arguments.size(); ++i) {
+        if (arguments.at(i) == QLatin1String("-update")) {
+            update = true;
+        } else if (arguments.at(i) == QLatin1String("-jobs") && i + 1 < arguments.size()) {
+            jobs = arguments.at(++i).toInt();
+        } else {
+            args << arguments.at(i);
+        }
+    }
+
+    Golden golden(update, jobs);
+    return QTest::qExec(&golden, args);
+}
@@ -0,0 +1,76 @@
+/*
+Copyright (C) 2019  Akhil K Gangadharan <helloimakhil@gmail.com>
+This file is part of Kdenlive. See www.kdenlive.org.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of
+the License or (at your option) version 3 or any later version
+accepted by the membership of KDE e.V. (or its successor approved
+by the membership of KDE e.V.), which shall act as a proxy
+defined in Section 14 of version 3 of the license.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TST_GOLDEN_H
+#define TST_GOLDEN_H
+
+#include <QObject>
+#include <QtTest>
+#include <QMap>
+#include <QMutex>
+#include <QVector>
+#include "qmlrenderer.h"
+
+/*
+ * Renders the templates listed in cases.txt at the listed frames and compares
+ * them with the PNG goldens in images/ by PSNR and SSIM. All cases are rendered
+ * up front, several templates at once. Failing frames are written with a
+ * difference image to golden_failures/ in the working directory.
+ *
+ * Runs headless, offscreen and on software GL unless the environment says
+ * otherwise. Goldens depend on the rasteriser, so they are generated with the
+ * same setup by the test itself:
+ *   ./goldentest -update [-jobs N]
+*/
+class Golden : public QObject
+{
+    Q_OBJECT
+
+public:
+    Golden(bool update, int jobs);
+
+private slots:
+    void initTestCase();
+    void compare_data();
+    void compare();
+
+private:
+    struct Case {
+        QString name;
+        QString file;
+        QSize size;
+        int fps;
+        int duration;
+        QList<int> frames;
+    };
+
+    bool loadCases(QString *error);
+    void renderCases();
+    static QString key(const QString &name, int frame);
+
+    bool m_update;
+    int m_jobs;
+    QVector<Case> m_cases;
+    QMutex m_mutex;
+    QMap<QString, QImage> m_rendered;
+};
+
+#endif // TST_GOLDEN_H
@@ -0,0 +1,14 @@
+import QtQuick 2.0
+
+Rectangle {
+    property string title: "Title"
+    property color textColor: "white"
+    color: "#202020"
+
+    Text {
+        anchors.centerIn: parent
+        text: parent.title + " " + subtitle
+        color: parent.textColor
+        font.pixelSize: 32
+    }
+}
@@ -23,6 +23,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "qmlrenderer.h"
 #include <QObject>
 #include <QTest>
+#include <QTemporaryDir>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
 #include <memory>
 
 Render::Render()
@@ -82,4 +86,658 @@ void Render::test_case1()
 //    qDebug() << " FINAL VALUES == " << i << " " << totalFrames;
 }
 
+void Render::test_sessionSeek()
+{
+    const QString qmlFile = QUrl::fromLocalFile(refDir + "/test.qml").toString();
+    QmlRenderer session(qmlFile, 25, 1);
+    session.render(720, 596, QImage::Format_ARGB32, 10);
+    session.render(720, 596, QImage::Format_ARGB32, 20);
+    // Seeking backwards rewinds the session and must give the same frame as a fresh render
+    QImage rewound = session.render(720, 596, QImage::Format_ARGB32, 5);
+
+    QmlRenderer replay(qmlFile, 25, 1);
+    replay.setSessionMode(false);
+    QImage expected = replay.render(720, 596, QImage::Format_ARGB32, 5);
+
+    QCOMPARE(rewound, expected);
+}
+
+void Render::test_alternatingRenderers()
+{
+    const QString qmlFile = QUrl::fromLocalFile(refDir + "/test.qml").toString();
+    QMap<int, QImage> expected;
+    QmlRenderer reference(qmlFile, 25, 1);
+    for (int frame : { 4, 8, 12 }) {
+        expected.insert(frame, reference.render(320, 240, QImage::Format_ARGB32, frame));
+    }
+
+    // Two renderers on one thread take turns, each one follows its own clock
+    QmlRenderer first(qmlFile, 25, 1);
+    QmlRenderer second(qmlFile, 25, 1);
+    const QList<int> firstFrames = { 4, 8, 12 };
+    const QList<int> secondFrames = { 12, 4, 8 };
+    for (int i = 0; i < firstFrames.size(); ++i) {
+        QCOMPARE(first.render(320, 240, QImage::Format_ARGB32, firstFrames.at(i)), expected.value(firstFrames.at(i)));
+        QCOMPARE(second.render(320, 240, QImage::Format_ARGB32, secondFrames.at(i)), expected.value(secondFrames.at(i)));
+    }
+}
+
+void Render::test_renderRange()
+{
+    const QString qmlFile = QUrl::fromLocalFile(refDir + "/test.qml").toString();
+    QmlRenderer batch(qmlFile, 25, 1);
+    QList<int> frames;
+    QImage lastImage;
+    int count = batch.renderRange(720, 596, QImage::Format_ARGB32, 0, 24, [&](int frame, const QImage &image) {
+        frames << frame;
+        lastImage = image;
+    });
+
+    QCOMPARE(count, 25);
+    QCOMPARE(frames.size(), 25);
+    QCOMPARE(frames.first(), 0);
+    QCOMPARE(frames.last(), 24);
+
+    QmlRenderer single(qmlFile, 25, 1);
+    QCOMPARE(single.render(720, 596, QImage::Format_ARGB32, 24), lastImage);
+}
+
+void Render::test_renderIntoBuffer()
+{
+    const QString qmlFile = QUrl::fromLocalFile(refDir + "/test.qml").toString();
+    QmlRenderer renderer(qmlFile, 25, 1);
+    QImage expected = renderer.render(720, 596, QImage::Format_ARGB32, 12);
+
+    QmlRenderer direct(qmlFile, 25, 1);
+    QImage target(720, 596, QImage::Format_ARGB32);
+    QVERIFY(direct.render(720, 596, QImage::Format_ARGB32, 12, target.bits(), target.bytesPerLine()));
+    QCOMPARE(target, expected);
+
+    // The scene still shows frame 12, rendering it again must not rewind
+    target.fill(Qt::black);
+    QVERIFY(direct.render(720, 596, QImage::Format_ARGB32, 12, target.bits(), target.bytesPerLine()));
+    QCOMPARE(target, expected);
+
+    // Frames past the end and framebuffers larger than the buffer leave it alone
+    target.fill(Qt::black);
+    const QImage untouched = target.copy();
+    QVERIFY(!direct.render(720, 596, QImage::Format_ARGB32, 25, target.bits(), target.bytesPerLine()));
+    direct.setDevicePixelRatio(2.0);
+    QVERIFY(!direct.render(720, 596, QImage::Format_ARGB32, 12, target.bits(), target.bytesPerLine()));
+    QCOMPARE(target, untouched);
+}
+
+void Render::test_parallelRender()
+{
+    const QString qmlFile = QUrl::fromLocalFile(refDir + "/test.qml").toString();
+    QMap<int, QImage> expected;
+    QmlRenderer sequential(qmlFile, 25, 1);
+    sequential.renderRange(320, 240, QImage::Format_ARGB32, 0, 24, [&](int frame, const QImage &image) {
+        expected.insert(frame, image);
+    });
+
+    QmlParallelRenderer parallel(qmlFile, 25, 1, 3);
+    QList<int> frames;
+    QList<QImage> images;
+    int count = parallel.renderRange(320, 240, QImage::Format_ARGB32, 0, 24, [&](int frame, const QImage &image) {
+        frames << frame;
+        images << image;
+    });
+
+    QCOMPARE(count, 25);
+    QCOMPARE(frames.size(), 25);
+    for (int i = 0; i < frames.size(); ++i) {
+        QCOMPARE(frames.at(i), i);
+        QCOMPARE(images.at(i), expected.value(i));
+    }
+}
+
+void Render::test_frameClock()
+{
+    // 29.97 fps: frame n starts at n * 1001 / 30 ms, without drift
+    QCOMPARE(QmlAnimationDriver::frameTime(1, 30000, 1001), qint64(33));
+    QCOMPARE(QmlAnimationDriver::frameTime(30, 30000, 1001), qint64(1001));
+    QCOMPARE(QmlAnimationDriver::frameTime(107892, 30000, 1001), qint64(3599996));
+    QCOMPARE(QmlAnimationDriver::frameTime(25, 25, 1), qint64(1000));
+
+    QmlAnimationDriver driver(30000, 1001);
+    driver.seekToFrame(300);
+    QCOMPARE(driver.elapsed(), qint64(10010));
+    driver.advance();
+    QCOMPARE(driver.frame(), qint64(301));
+
+    // The rectangle of test.qml moves 20 pixels per frame at 25 fps from the first frame
+    // on, an animation started late would trail by a frame
+    const QString qmlFile = QUrl::fromLocalFile(refDir + "/test.qml").toString();
+    QmlRenderer renderer(qmlFile, 25, 2);
+    for (int frame : { 5, 6, 12 }) {
+        const QImage image = renderer.render(720, 596, QImage::Format_ARGB32, frame);
+        QCOMPARE(image.pixel(20 * frame, 80), qRgba(0xb0, 0x18, 0x18, 0xff));
+        QCOMPARE(image.pixel(20 * frame - 1, 80), qRgba(0xff, 0xff, 0xff, 0xff));
+    }
+
+    // At 29.97 fps frame 15 starts at 500.5 ms, the rectangle is at x = 250.25
+    QmlRenderer ntsc(qmlFile, 30, 2);
+    ntsc.setFrameRate(30000, 1001);
+    const QImage image = ntsc.render(720, 596, QImage::Format_ARGB32, 15);
+    QCOMPARE(image.pixel(252, 80), qRgba(0xb0, 0x18, 0x18, 0xff));
+    QCOMPARE(image.pixel(248, 80), qRgba(0xff, 0xff, 0xff, 0xff));
+}
+
+void Render::test_snapshots()
+{
+    const QString qmlFile = QUrl::fromLocalFile(refDir + "/test.qml").toString();
+    QmlRenderer renderer(qmlFile, 25, 2);
+    renderer.setSnapshotInterval(10);
+    renderer.renderRange(320, 240, QImage::Format_ARGB32, 0, 49, [](int, const QImage &) {});
+    QCOMPARE(renderer.snapshotCount(), 4);
+
+    // Restores the snapshot of frame 20 and continues from there
+    QImage restored = renderer.render(320, 240, QImage::Format_ARGB32, 23);
+    QmlRenderer fresh(qmlFile, 25, 2);
+    QCOMPARE(restored, fresh.render(320, 240, QImage::Format_ARGB32, 23));
+
+    renderer.setSnapshotMemoryLimit(0);
+    QCOMPARE(renderer.snapshotCount(), 0);
+}
+
+void Render::test_frameCache()
+{
+    const QString qmlFile = QUrl::fromLocalFile(refDir + "/test.qml").toString();
+    QmlFrameCache cache;
+    QmlRenderer renderer(qmlFile, 25, 2);
+    renderer.setFrameCache(&cache);
+
+    QImage rendered = renderer.render(320, 240, QImage::Format_ARGB32, 10);
+    QCOMPARE(cache.misses(), 1);
+    const QImage renderedLater = renderer.render(320, 240, QImage::Format_ARGB32, 20);
+    QCOMPARE(renderer.render(320, 240, QImage::Format_ARGB32, 10), rendered);
+    QCOMPARE(cache.hits(), 1);
+    QCOMPARE(cache.count(), 2);
+
+    // A second renderer of the same file shares the frames
+    QmlRenderer other(qmlFile, 25, 2);
+    other.setFrameCache(&cache);
+    QCOMPARE(other.render(320, 240, QImage::Format_ARGB32, 10), rendered);
+    QCOMPARE(cache.hits(), 2);
+
+    // Frames pushed out of memory come back from disk, frame 20 is the least recently used
+    QTemporaryDir dir;
+    cache.setDiskDirectory(dir.path());
+    cache.setMemoryLimit(rendered.sizeInBytes());
+    QCOMPARE(cache.count(), 1);
+    QCOMPARE(renderer.render(320, 240, QImage::Format_ARGB32, 20), renderedLater);
+    QCOMPARE(cache.diskHits(), 1);
+}
+
+void Render::test_staticScene()
+{
+    const QString qmlFile = QUrl::fromLocalFile(refDir + "/test0.qml").toString();
+    QmlRenderer renderer(qmlFile, 25, 1);
+    QImage first = renderer.render(320, 240, QImage::Format_ARGB32, 0);
+    QList<QImage> frames;
+    renderer.renderRange(320, 240, QImage::Format_ARGB32, 1, 24, [&frames](int, const QImage &image) {
+        frames.append(image);
+    });
+    QCOMPARE(frames.count(), 24);
+    QCOMPARE(frames.last(), first);
+    QCOMPARE(renderer.staticFramesServed(), 24);
+}
+
+void Render::test_dirtyRect_data()
+{
+    QTest::addColumn<bool>("asyncReadback");
+    QTest::addColumn<qreal>("dpr");
+    QTest::newRow("sync") << false << 1.0;
+    QTest::newRow("async") << true << 1.0;
+    QTest::newRow("sync dpr 2") << false << 2.0;
+    QTest::newRow("async dpr 2") << true << 2.0;
+}
+
+void Render::test_dirtyRect()
+{
+    QFETCH(bool, asyncReadback);
+    QFETCH(qreal, dpr);
+    const QString qmlFile = QUrl::fromLocalFile(refDir + "/test.qml").toString();
+    QmlRenderer renderer(qmlFile, 25, 2);
+    renderer.setAsyncReadback(asyncReadback);
+    renderer.setPartialReadback(true);
+    renderer.setDevicePixelRatio(dpr);
+    QImage last;
+    renderer.renderRange(720, 596, QImage::Format_ARGB32, 0, 10, [&last](int, const QImage &image) {
+        last = image;
+    });
+
+    // Only the strip the rectangle moves along is read back, in output pixels
+    const QRect dirty = renderer.dirtyRect();
+    QVERIFY(!dirty.isEmpty());
+    QVERIFY(dirty.height() < 200 * dpr);
+    QVERIFY(QRect(0, 0, 720 * dpr, 596 * dpr).contains(dirty));
+    QVERIFY(dirty.contains(QRect(200 * dpr, 0, 155 * dpr, 160 * dpr)));
+
+    // Off by default, every frame is read back completely
+    QmlRenderer fresh(qmlFile, 25, 2);
+    fresh.setDevicePixelRatio(dpr);
+    QCOMPARE(last, fresh.render(720, 596, QImage::Format_ARGB32, 10));
+    QCOMPARE(fresh.render(720, 596, QImage::Format_ARGB32, 11).size(), QSize(720 * dpr, 596 * dpr));
+    QCOMPARE(fresh.dirtyRect(), QRect(0, 0, 720 * dpr, 596 * dpr));
+}
+
+void Render::test_rendererPool()
+{
+    const QString qmlFile = QUrl::fromLocalFile(refDir + "/test.qml").toString();
+    QmlRenderer reference(qmlFile, 25, 1);
+    const QImage expected = reference.render(320, 240, QImage::Format_ARGB32, 12);
+
+    QmlRendererPool pool(1);
+    QCOMPARE(pool.idleCount(), 1);
+    QmlRenderer *first = pool.acquire(qmlFile, 25, 1);
+    first->setDevicePixelRatio(2.0);
+    first->stats()->setEnabled(true);
+    QCOMPARE(first->render(320, 240, QImage::Format_ARGB32, 12).size(), QSize(640, 480));
+    pool.release(first);
+
+    // The returned renderer is reused with the default options and starts from the first frame again
+    QmlRenderer *second = pool.acquire(qmlFile, 25, 1);
+    QCOMPARE(second, first);
+    QVERIFY(!second->stats()->isEnabled());
+    QCOMPARE(second->render(320, 240, QImage::Format_ARGB32, 12), expected);
+    QCOMPARE(pool.createdCount(), 1);
+
+    // Renderers beyond the warm count go away once idle for long enough
+    QmlRenderer *extra = pool.acquire(qmlFile, 25, 1);
+    QCOMPARE(pool.createdCount(), 2);
+    pool.release(second);
+    pool.release(extra);
+    pool.setIdleTimeout(10);
+    QTRY_COMPARE(pool.idleCount(), 1);
+}
+
+// Resident set size of this process in kB, -1 where /proc is not available
+static qint64 residentMemory()
+{
+    QFile status(QStringLiteral("/proc/self/status"));
+    if (!status.open(QIODevice::ReadOnly)) {
+        return -1;
+    }
+    for (const QByteArray &line : status.readAll().split('\n')) {
+        if (line.startsWith("VmRSS:")) {
+            return line.mid(6).trimmed().split(' ').first().toLongLong();
+        }
+    }
+    return -1;
+}
+
+void Render::test_sharedEngine()
+{
+    if (residentMemory() < 0) {
+        QSKIP("Needs /proc/self/status");
+    }
+    const QString qmlFile = QUrl::fromLocalFile(refDir + "/test.qml").toString();
+    const int count = 8;
+
+    qint64 before = residentMemory();
+    QList<QmlRenderer *> privateEngines;
+    for (int i = 0; i < count; ++i) {
+        privateEngines << new QmlRenderer(qmlFile, 25, 1);
+        privateEngines.last()->render(320, 240, QImage::Format_ARGB32, 0);
+    }
+    const qint64 privateCost = (residentMemory() - before) / count;
+    const QImage expected = privateEngines.first()->render(320, 240, QImage::Format_ARGB32, 12);
+    qDeleteAll(privateEngines);
+
+    QQmlEngine engine;
+    QCOMPARE(QmlComponentCache::forEngine(&engine)->preload(QList<QUrl>() << QUrl(qmlFile)), 1);
+    before = residentMemory();
+    QList<QmlRenderer *> sharedEngine;
+    for (int i = 0; i < count; ++i) {
+        sharedEngine << new QmlRenderer(qmlFile, 25, 1, &engine);
+        sharedEngine.last()->render(320, 240, QImage::Format_ARGB32, 0);
+    }
+    const qint64 sharedCost = (residentMemory() - before) / count;
+    QCOMPARE(sharedEngine.first()->render(320, 240, QImage::Format_ARGB32, 12), expected);
+    qDeleteAll(sharedEngine);
+
+    qDebug() << "Memory per renderer: private engine" << privateCost << "kB, shared engine" << sharedCost << "kB";
+    QVERIFY(sharedCost < privateCost);
+    QCOMPARE(QmlComponentCache::forEngine(&engine)->count(), 1);
+}
+
+void Render::test_loadSource()
+{
+    const QString qmlFile = QUrl::fromLocalFile(refDir + "/test0.qml").toString();
+    QQmlEngine engine;
+    QmlRenderer first(qmlFile, 25, 1, &engine);
+    first.render(320, 240, QImage::Format_ARGB32, 0);
+    QVERIFY(first.loadSource() == QmlComponentCache::Compiled || first.loadSource() == QmlComponentCache::DiskCache);
+
+    QmlRenderer second(qmlFile, 25, 1, &engine);
+    second.render(320, 240, QImage::Format_ARGB32, 0);
+    QCOMPARE(second.loadSource(), QmlComponentCache::MemoryCache);
+
+    // Once compiled, a new engine loads the template from the disk cache
+    if (QFileInfo::exists(QmlComponentCache::diskCacheFile(QUrl(qmlFile)))) {
+        QmlRenderer other(qmlFile, 25, 1);
+        other.render(320, 240, QImage::Format_ARGB32, 0);
+        QCOMPARE(other.loadSource(), QmlComponentCache::DiskCache);
+    }
+}
+
+void Render::test_properties()
+{
+    const QString qmlFile = QUrl::fromLocalFile(refDir + "/title.qml").toString();
+    QVariantMap first;
+    first.insert("title", "First");
+    first.insert("textColor", QColor(Qt::red));
+    QVariantMap second;
+    second.insert("title", "Second");
+    second.insert("textColor", QColor(Qt::green));
+
+    QmlRenderer fresh(qmlFile, 25, 1);
+    fresh.setContextProperties(QVariantMap{{"subtitle", "A"}});
+    fresh.setProperties(second);
+    const QImage expected = fresh.render(320, 240, QImage::Format_ARGB32, 0);
+
+    // Switching variants updates the live scene and gives the same frame as a new scene
+    QmlRenderer renderer(qmlFile, 25, 1);
+    renderer.setContextProperties(QVariantMap{{"subtitle", "A"}});
+    renderer.setProperties(first);
+    const QImage firstImage = renderer.render(320, 240, QImage::Format_ARGB32, 0);
+    const QmlComponentCache::LoadSource loaded = renderer.loadSource();
+    QVERIFY(loaded != QmlComponentCache::MemoryCache);
+    renderer.setProperties(second);
+    QCOMPARE(renderer.render(320, 240, QImage::Format_ARGB32, 0), expected);
+    QVERIFY(firstImage != expected);
+    // A reload would have found the component in the memory cache of the engine
+    QCOMPARE(renderer.loadSource(), loaded);
+
+    renderer.setContextProperties(QVariantMap{{"subtitle", "B"}});
+    const QImage subtitleB = renderer.render(320, 240, QImage::Format_ARGB32, 0);
+    QVERIFY(subtitleB != expected);
+    // Keys left out keep their value, in the scene and in the state frames are cached under
+    renderer.setContextProperties(QVariantMap());
+    QCOMPARE(renderer.contextProperties().value("subtitle").toString(), QString("B"));
+    QCOMPARE(renderer.render(320, 240, QImage::Format_ARGB32, 0), subtitleB);
+    renderer.setProperties(QVariantMap{{"textColor", QColor(Qt::green)}});
+    QCOMPARE(renderer.properties().value("title").toString(), QString("Second"));
+    QCOMPARE(renderer.render(320, 240, QImage::Format_ARGB32, 0), subtitleB);
+}
+
+void Render::test_renderStats()
+{
+    const QString qmlFile = QUrl::fromLocalFile(refDir + "/test.qml").toString();
+    QmlRenderer renderer(qmlFile, 25, 1);
+    renderer.render(320, 240, QImage::Format_ARGB32, 0);
+    QCOMPARE(renderer.stats()->summary(QmlRenderStats::Render).count, 0);
+
+    renderer.stats()->setEnabled(true);
+    renderer.renderRange(320, 240, QImage::Format_ARGB32, 1, 10, [](int, const QImage &) {});
+    renderer.stats()->setEnabled(false);
+
+    const QmlRenderStats::Summary render = renderer.stats()->summary(QmlRenderStats::Render);
+    QVERIFY(render.count > 0);
+    QCOMPARE(renderer.stats()->summary(QmlRenderStats::Sync).count, render.count);
+    QCOMPARE(renderer.stats()->summary(QmlRenderStats::Advance).count, 10);
+    QVERIFY(render.min <= render.p50);
+    QVERIFY(render.p50 <= render.p95);
+    QVERIFY(render.p95 <= render.p99);
+    QVERIFY(render.p99 <= render.max);
+
+    const QJsonDocument trace = QJsonDocument::fromJson(renderer.stats()->chromeTrace());
+    const QJsonArray events = trace.object().value("traceEvents").toArray();
+    QVERIFY(!events.isEmpty());
+    QCOMPARE(events.first().toObject().value("ph").toString(), QString("X"));
+
+    renderer.stats()->reset();
+    QCOMPARE(renderer.stats()->summary(QmlRenderStats::Render).count, 0);
+}
+
+void Render::test_resize()
+{
+    const QString qmlFile = QUrl::fromLocalFile(refDir + "/test.qml").toString();
+    QmlRenderer fresh(qmlFile, 25, 1);
+    const QImage expected = fresh.render(640, 480, QImage::Format_ARGB32, 12);
+
+    // Switching from proxy to full size continues the animation of the live scene
+    QmlRenderer renderer(qmlFile, 25, 1);
+    for (int frame = 0; frame < 12; ++frame) {
+        QCOMPARE(renderer.render(320, 240, QImage::Format_ARGB32, frame).size(), QSize(320, 240));
+    }
+    const QmlComponentCache::LoadSource loaded = renderer.loadSource();
+    QVERIFY(loaded != QmlComponentCache::MemoryCache);
+    QCOMPARE(renderer.render(640, 480, QImage::Format_ARGB32, 12), expected);
+    // A reload would have found the component in the memory cache of the engine
+    QCOMPARE(renderer.loadSource(), loaded);
+
+    // Same frame in another format is rendered again, not handed out from before
+    const QImage rgb = renderer.render(640, 480, QImage::Format_RGB888, 12);
+    QCOMPARE(rgb.format(), QImage::Format_RGB888);
+    QCOMPARE(rgb, expected.convertToFormat(QImage::Format_RGB888));
+
+    // The scene fills the larger image: in frame 13 the rectangle spans x 260 to 415
+    renderer.setDevicePixelRatio(2.0);
+    const QImage scaled = renderer.render(320, 240, QImage::Format_ARGB32, 13);
+    QCOMPARE(scaled.size(), QSize(640, 480));
+    QCOMPARE(scaled.pixel(600, 200), qRgba(0xb0, 0x18, 0x18, 0xff));
+    QCOMPARE(scaled.pixel(400, 200), qRgba(0xff, 0xff, 0xff, 0xff));
+}
+
+void Render::bench_renderRange_data()
+{
+    QTest::addColumn<bool>("asyncReadback");
+    QTest::addColumn<bool>("pipelined");
+
+    QTest::newRow("synchronous") << false << false;
+    QTest::newRow("async readback") << true << false;
+    QTest::newRow("pipelined") << true << true;
+}
+
+void Render::bench_renderRange()
+{
+    QFETCH(bool, asyncReadback);
+    QFETCH(bool, pipelined);
+    const QString qmlFile = QUrl::fromLocalFile(refDir + "/test.qml").toString();
+    QmlRenderer renderer(qmlFile, 25, 1);
+    renderer.setAsyncReadback(asyncReadback);
+    renderer.setPipelinedRendering(pipelined);
+
+    int frames = 0;
+    QElapsedTimer timer;
+    timer.start();
+    QBENCHMARK {
+        renderer.reset();
+        frames += renderer.renderRange(1280, 720, QImage::Format_ARGB32, 0, 24, [](int, const QImage &) {});
+    }
+    qDebug() << QTest::currentDataTag() << "fps:" << frames * 1000.0 / qMax<qint64>(1, timer.elapsed());
+}
+
+// Premultiplied RGBA8888 frame as glReadPixels would return it
+static QImage readbackFrame(int width, int height)
+{
+    QImage frame(width, height, QImage::Format_RGBA8888_Premultiplied);
+    for (int y = 0; y < height; ++y) {
+        uchar *line = frame.scanLine(y);
+        for (int x = 0; x < width; ++x, line += 4) {
+            const uchar a = uchar((x * 7 + y * 3) % 256);
+            line[0] = uchar(a ? (x * 13 + y) % (a + 1) : 0);
+            line[1] = uchar(a ? (x + y * 11) % (a + 1) : 0);
+            line[2] = uchar(a ? (x * y) % (a + 1) : 0);
+            line[3] = a;
+        }
+    }
+    return frame;
+}
+
+static QByteArray convertFrame(const QImage &frame, QmlPixelConverter::PixelFormat format)
+{
+    const int planes = QmlPixelConverter::planeCount(format);
+    QByteArray output;
+    QmlPixelConverter::Plane plane[3];
+    QVector<int> offsets;
+    for (int i = 0; i < planes; ++i) {
+        const QSize size = QmlPixelConverter::planeSize(format, i, frame.size());
+        offsets << output.size();
+        output.resize(output.size() + size.width() * (planes == 1 ? 4 : 1) * size.height());
+    }
+    for (int i = 0; i < planes; ++i) {
+        const QSize size = QmlPixelConverter::planeSize(format, i, frame.size());
+        plane[i] = { reinterpret_cast<uchar *>(output.data()) + offsets[i], size.width() * (planes == 1 ? 4 : 1) };
+    }
+    QmlPixelConverter::convert(frame.constBits(), frame.bytesPerLine(), frame.size(), true, format, plane);
+    return output;
+}
+
+void Render::test_pixelConverter()
+{
+    const QImage frame = readbackFrame(101, 37);
+    const QmlPixelConverter::Isa best = QmlPixelConverter::bestIsa();
+
+    for (int format = QmlPixelConverter::RGBA8888; format <= QmlPixelConverter::YUV422P; ++format) {
+        QmlPixelConverter::setIsa(QmlPixelConverter::Scalar);
+        const QByteArray reference = convertFrame(frame, QmlPixelConverter::PixelFormat(format));
+        for (int isa = QmlPixelConverter::SSE2; isa <= best; ++isa) {
+            QmlPixelConverter::setIsa(QmlPixelConverter::Isa(isa));
+            QCOMPARE(convertFrame(frame, QmlPixelConverter::PixelFormat(format)), reference);
+        }
+    }
+    QmlPixelConverter::setIsa(best);
+
+    // Swizzling premultiplied pixels is lossless, so it must match Qt exactly
+    QmlPixelConverter::PixelFormat argb;
+    if (QmlPixelConverter::fromImageFormat(QImage::Format_ARGB32_Premultiplied, &argb)) {
+        QImage converted(frame.size(), QImage::Format_ARGB32_Premultiplied);
+        const QmlPixelConverter::Plane plane = { converted.bits(), converted.bytesPerLine() };
+        QmlPixelConverter::convert(frame.constBits(), frame.bytesPerLine(), frame.size(), true, argb, &plane);
+        QCOMPARE(converted, frame.mirrored().convertToFormat(QImage::Format_ARGB32_Premultiplied));
+    }
+}
+
+void Render::test_multiResolution()
+{
+    const QString qmlFile = QUrl::fromLocalFile(refDir + "/test.qml").toString();
+    const QVector<QSize> sizes = { QSize(640, 480), QSize(320, 240), QSize(160, 120) };
+    QmlRenderer single(qmlFile, 25, 1);
+    QList<QImage> expected;
+    single.renderRange(640, 480, QImage::Format_ARGB32, 0, 12, [&](int, const QImage &image) {
+        expected << image;
+    });
+
+    // The scene is evaluated once per frame, at the first size
+    QmlRenderer multi(qmlFile, 25, 1);
+    int count = multi.renderRange(sizes, QImage::Format_ARGB32, 0, 12, [&](int frame, const QVector<QImage> &images) {
+        QCOMPARE(images.size(), sizes.size());
+        QCOMPARE(images.first(), expected.at(frame));
+        for (int i = 1; i < images.size(); ++i) {
+            QCOMPARE(images.at(i).size(), sizes.at(i));
+            QCOMPARE(images.at(i).format(), QImage::Format_ARGB32);
+        }
+    });
+    QCOMPARE(count, 13);
+
+    // The rectangle is at x = 240 in frame 12, halves and quarters are plain 2x2 and 4x4 averages
+    const QVector<QImage> images = multi.render(sizes, QImage::Format_ARGB32, 12);
+    QCOMPARE(images.at(1).pixel(130, 40), images.at(0).pixel(260, 80));
+    QCOMPARE(images.at(2).pixel(65, 20), images.at(0).pixel(260, 80));
+    QCOMPARE(images.at(2).pixel(10, 100), qRgba(0xff, 0xff, 0xff, 0xff));
+
+    // Averaging gives the same result with every instruction set
+    const QImage frame = readbackFrame(101, 37);
+    const QmlPixelConverter::Isa best = QmlPixelConverter::bestIsa();
+    QmlPixelConverter::setIsa(QmlPixelConverter::Scalar);
+    QImage reference(QSize(23, 11), QImage::Format_RGBA8888_Premultiplied);
+    QmlPixelConverter::scale(frame.constBits(), frame.bytesPerLine(), frame.size(), reference.bits(), reference.bytesPerLine(), reference.size());
+    for (int isa = QmlPixelConverter::SSE2; isa <= best; ++isa) {
+        QmlPixelConverter::setIsa(QmlPixelConverter::Isa(isa));
+        QImage scaled(reference.size(), reference.format());
+        QmlPixelConverter::scale(frame.constBits(), frame.bytesPerLine(), frame.size(), scaled.bits(), scaled.bytesPerLine(), scaled.size());
+        QCOMPARE(scaled, reference);
+    }
+    QmlPixelConverter::setIsa(best);
+}
+
+void Render::bench_conversion_data()
+{
+    QTest::addColumn<int>("isa");
+    QTest::addColumn<int>("format");
+
+    // isa -1 is the Qt path used before: mirrored() followed by a QImage conversion
+    QTest::newRow("qt ARGB32_Premultiplied") << -1 << int(QImage::Format_ARGB32_Premultiplied);
+    QTest::newRow("qt ARGB32") << -1 << int(QImage::Format_ARGB32);
+    QTest::newRow("qt RGBA8888") << -1 << int(QImage::Format_RGBA8888);
+    const char *isaNames[] = { "scalar", "sse2", "avx2" };
+    for (int isa = QmlPixelConverter::Scalar; isa <= QmlPixelConverter::bestIsa(); ++isa) {
+        const QByteArray name(isaNames[isa]);
+        QTest::newRow(name + " BGRA8888_Premultiplied") << isa << int(QmlPixelConverter::BGRA8888_Premultiplied);
+        QTest::newRow(name + " BGRA8888") << isa << int(QmlPixelConverter::BGRA8888);
+        QTest::newRow(name + " RGBA8888") << isa << int(QmlPixelConverter::RGBA8888);
+        QTest::newRow(name + " YUV420P") << isa << int(QmlPixelConverter::YUV420P);
+        QTest::newRow(name + " YUV422P") << isa << int(QmlPixelConverter::YUV422P);
+    }
+}
+
+void Render::bench_conversion()
+{
+    QFETCH(int, isa);
+    QFETCH(int, format);
+    const QImage frame = readbackFrame(1920, 1080);
+
+    if (isa < 0) {
+        QBENCHMARK {
+            QImage image = frame.mirrored();
+            image.convertTo(QImage::Format(format));
+        }
+        return;
+    }
+
+    QmlPixelConverter::setIsa(QmlPixelConverter::Isa(isa));
+    QBENCHMARK {
+        convertFrame(frame, QmlPixelConverter::PixelFormat(format));
+    }
+    QmlPixelConverter::setIsa(QmlPixelConverter::bestIsa());
+}
+
+void Render::bench_jobLatency_data()
+{
+    QTest::addColumn<bool>("pooled");
+    QTest::newRow("new renderer") << false;
+    QTest::newRow("pooled renderer") << true;
+}
+
+void Render::bench_jobLatency()
+{
+    // One short job: set up, render a frame, tear down or hand back
+    QFETCH(bool, pooled);
+    const QString qmlFile = QUrl::fromLocalFile(refDir + "/test.qml").toString();
+    QmlRendererPool pool(1);
+
+    if (pooled) {
+        QBENCHMARK {
+            QmlRenderer *renderer = pool.acquire(qmlFile, 25, 1);
+            renderer->render(320, 240, QImage::Format_ARGB32, 5);
+            pool.release(renderer);
+        }
+        return;
+    }
+
+    QBENCHMARK {
+        QmlRenderer renderer(qmlFile, 25, 1);
+        renderer.render(320, 240, QImage::Format_ARGB32, 5);
+    }
+}
+
+void Render::bench_variants()
+{
+    // 100 variants of one template, each one a render of the live scene
+    const QString qmlFile = QUrl::fromLocalFile(refDir + "/title.qml").toString();
+    QmlRenderer renderer(qmlFile, 25, 1);
+    renderer.setContextProperties(QVariantMap{{"subtitle", ""}});
+    renderer.render(1280, 720, QImage::Format_ARGB32, 0);
+    QBENCHMARK {
+        for (int i = 0; i < 100; ++i) {
+            renderer.setProperties(QVariantMap{{"title", QString("Variant %1").arg(i)}});
+            renderer.render(1280, 720, QImage::Format_ARGB32, 0);
+        }
+    }
+}
+
 QTEST_MAIN(Render)
@@ -26,6 +26,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QObject>
 #include <QtTest>
 #include "qmlrenderer.h"
+#include "qmlparallelrenderer.h"
+#include "qmlrendererpool.h"
 
 // add necessary includes here
 
@@ -41,6 +43,32 @@ public:
 
 private slots:
     void test_case1();
+    void test_sessionSeek();
+    void test_alternatingRenderers();
+    void test_renderRange();
+    void test_renderIntoBuffer();
+    void test_pixelConverter();
+    void test_parallelRender();
+    void test_frameClock();
+    void test_snapshots();
+    void test_frameCache();
+    void test_staticScene();
+    void test_dirtyRect_data();
+    void test_dirtyRect();
+    void test_rendererPool();
+    void test_sharedEngine();
+    void test_loadSource();
+    void test_properties();
+    void test_renderStats();
+    void test_resize();
+    void test_multiResolution();
+    void bench_renderRange_data();
+    void bench_renderRange();
+    void bench_conversion_data();
+    void bench_conversion();
+    void bench_jobLatency_data();
+    void bench_jobLatency();
+    void bench_variants();
 
 };
 #endif // TST_RENDER_H